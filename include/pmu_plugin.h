@@ -13,21 +13,107 @@
 #define __PMU_PLUGIN_H__
 
 #include <securec.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include "interface.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define PMU_CYCLES_COUNTING "pmu_cycles_counting"
 #define PMU_CYCLES_SAMPLING "pmu_cycles_sampling"
+// pmu_uncore_counting lists rx_outer of every HHA, then rx_sccl and rx_ops_num, the units in
+// the byte order of their names as scandir with alphasort gave them: hisi_sccl11_hha0 comes
+// before hisi_sccl1_hha0, and both before hisi_sccl3_hha0.
 #define PMU_UNCORE "pmu_uncore_counting"
+#define PMU_UNCORE_MEM "pmu_uncore_mem_counting"
 #define PMU_SPE "pmu_spe_sampling"
 #define PMU_NETIF_RX "pmu_netif_rx_counting"
 #define PMU_NAPI_GRO_REC_ENTRY "pmu_napi_gro_rec_entry"
 #define PMU_SKB_COPY_DATEGRAM_IOVEC "pmu_skb_copy_datagram_iovec"
+#define PMU_DERIVED_METRICS "pmu_derived_metrics"
+#define PMU_CYCLES_SAMPLING_TOP "pmu_cycles_sampling_top"
+#define PMU_SPE_HEATMAP "pmu_spe_heatmap"
+#define PMU_UNCORE_TRAFFIC "pmu_uncore_traffic"
+
+/* Rereads the pmu plugin config file before the next run of an instance, reopening the
+ * instances whose settings changed. The plugin picks up a rewritten file by itself within
+ * about a second; a host that reloads on SIGHUP may call this from its handler to apply it
+ * at once. Async-signal-safe.
+ */
+void PmuReloadConfig(void);
+
+// PmuData::period of a pmu_spe_sampling record is the SPE period it was taken with, which
+// changes over time once pmu_spe_sampling.sample_budget is configured.
     
+// The ring buffers of the pmu instances count the readers of every published buffer, so a
+// reader can keep one zero-copy while the instance goes on publishing: take it with
+// PmuRingAcquire, use ref->data and ref->len, and give it back with PmuRingRelease.
+// DataBuf::data of the ring stays valid only until its slot is overwritten.
+#define PMU_RING_MAGIC 0x504d5552u
+
+struct PmuSlotRef {
+    // one held by the ring while the buffer is in its slot, one per reader
+    int refs;
+    int len;
+    void *data;
+    void (*freeData)(void *data);
+};
+
+// What get_ring_buf of a pmu instance points to.
+struct PmuRingBuf {
+    struct DataRingBuf ring;
+    unsigned int magic;
+    // readers between loading a slot and taking its reference
+    int acquiring;
+    struct PmuSlotRef **slots;
+};
+
+static inline void PmuRingRelease(const struct PmuSlotRef *ref)
+{
+    struct PmuSlotRef *slotRef = (struct PmuSlotRef *)ref;
+
+    if (slotRef == NULL || __atomic_sub_fetch(&slotRef->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+    if (slotRef->data != NULL && slotRef->freeData != NULL) {
+        slotRef->freeData(slotRef->data);
+    }
+    free(slotRef);
+}
+
+// Takes the buffer in slot index of a pmu ring, NULL if the slot is empty.
+static inline const struct PmuSlotRef *PmuRingAcquire(const struct DataRingBuf *ring, int index)
+{
+    struct PmuRingBuf *pmuRing;
+    struct PmuSlotRef *ref;
+
+    pmuRing = (struct PmuRingBuf *)(uintptr_t)ring;
+    if (ring == NULL || pmuRing->magic != PMU_RING_MAGIC || index < 0 || index >= ring->buf_len) {
+        return NULL;
+    }
+    __atomic_add_fetch(&pmuRing->acquiring, 1, __ATOMIC_SEQ_CST);
+    ref = __atomic_load_n(&pmuRing->slots[index], __ATOMIC_SEQ_CST);
+    if (ref != NULL) {
+        __atomic_add_fetch(&ref->refs, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_sub_fetch(&pmuRing->acquiring, 1, __ATOMIC_SEQ_CST);
+
+    return ref;
+}
+
+// Takes the newest buffer of a pmu ring.
+static inline const struct PmuSlotRef *PmuRingAcquireLatest(const struct DataRingBuf *ring)
+{
+    if (ring == NULL) {
+        return NULL;
+    }
+    return PmuRingAcquire(ring, __atomic_load_n(&ring->index, __ATOMIC_ACQUIRE));
+}
+
 #define NAPI_GRO_REC_ENTRY_DEVICE_LEN 64
 // ref : /sys/kernel/debug/tracing/events/net/napi_gro_receive_entry/format
 struct NapiGroRecEntryData {
@@ -87,6 +173,137 @@ static inline errno_t SkbCopyDatagramIovecResolve(char *raw, struct SkbCopyDatag
     return memcpy_s(data, sizeof(struct SkbCopyDatagramIovecData), raw, sizeof(struct SkbCopyDatagramIovecData));
 }
 
+// The slot of pmu_derived_metrics holds one entry per cpu, indexed by cpu, followed by
+// the system-wide entry with cpu PMU_METRICS_ALL_CPU. Counts and rates cover interval.
+#define PMU_METRICS_ALL_CPU (-1)
+struct PmuCpuMetrics {
+    int cpu;
+    uint32_t intervalUs;
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t cacheMisses;
+    uint64_t branchMisses;
+    double ipc;
+    // misses per 1000 instructions
+    double cacheMpki;
+    double branchMpki;
+    // per second
+    double cyclesRate;
+    double instructionsRate;
+    double cacheMissesRate;
+    double branchMissesRate;
+    // hha uncore events per second summed over all units, system-wide entry only
+    double uncoreRxOuterRate;
+    double uncoreRxScclRate;
+    double uncoreRxOpsRate;
+};
+
+#define PMU_TOP_COMM_LEN 16
+#define PMU_TOP_SYMBOL_LEN 128
+#define PMU_TOP_MODULE_LEN 64
+// The slot of pmu_cycles_sampling_top: the (pid, function) pairs with the most cycles samples
+// in the interval, hottest first. Names are copied and truncated, the symbol is empty if it
+// could not be resolved and addr is then the sampled address.
+struct PmuSymbolTop {
+    int pid;
+    char comm[PMU_TOP_COMM_LEN];
+    uint64_t samples;
+    // sum of the sample periods, cycles spent in the function
+    uint64_t period;
+    uint64_t addr;
+    char symbol[PMU_TOP_SYMBOL_LEN];
+    // file name of the binary or library
+    char module[PMU_TOP_MODULE_LEN];
+};
+
+#define PMU_BUILD_ID_LEN 41
+// An address of a sample taken with symbol_mode = raw, resolved by PmuResolveSymbol.
+struct PmuSymbolInfo {
+    // empty if the address is in no known function
+    char symbol[PMU_TOP_SYMBOL_LEN];
+    char module[PMU_TOP_MODULE_LEN];
+    // hex, empty if the binary has none
+    char buildId[PMU_BUILD_ID_LEN];
+    // offset of the address in the module file, the address itself for the kernel
+    uint64_t offset;
+};
+
+/* Resolves addr of process pid through the symbol cache of the pmu plugin, which maps each
+ * binary once and remembers every (build-id, offset) asked for. Returns 0 on success and -1 if
+ * addr is in no readable binary. Safe to call from any thread.
+ */
+int PmuResolveSymbol(int pid, uint64_t addr, struct PmuSymbolInfo *info);
+
+#define PMU_HEATMAP_NODE_MAX 16
+#define PMU_HEATMAP_UNKNOWN_NODE (-1)
+#define PMU_HEATMAP_LAT_BUCKETS 8
+// hist[0] counts latencies below 64 cycles, hist[i] those in [32 << i, 64 << i) and the last
+// bucket everything from 4096 cycles on.
+struct PmuNodeLatency {
+    // PMU_HEATMAP_UNKNOWN_NODE for the samples without a physical address
+    int node;
+    uint32_t samples;
+    uint64_t latencySum;
+    uint32_t hist[PMU_HEATMAP_LAT_BUCKETS];
+};
+
+struct PmuHeatmapPage {
+    int pid;
+    // node of ppage, PMU_HEATMAP_UNKNOWN_NODE if unknown
+    int node;
+    // page numbers, address >> pageShift; ppage is 0 without a physical address
+    uint64_t vpage;
+    uint64_t ppage;
+    // a lower bound once the interval touched more pages than are tracked
+    uint32_t samples;
+    uint32_t avgLatency;
+};
+
+// The single entry of a pmu_spe_heatmap slot.
+struct PmuSpeHeatmap {
+    uint32_t intervalUs;
+    // SPE period in use, which a sample_budget adapts: samples * period estimates the operations
+    uint32_t period;
+    int pageShift;
+    // SPE records with a data address, and those of pages not tracked
+    uint32_t samples;
+    uint32_t untracked;
+    int nodeNum;
+    struct PmuNodeLatency nodes[PMU_HEATMAP_NODE_MAX + 1];
+    // hottest first, in the same allocation
+    int pageNum;
+    struct PmuHeatmapPage *pages;
+};
+
+enum PmuTrafficScope {
+    PMU_TRAFFIC_HHA,
+    PMU_TRAFFIC_SOCKET,
+};
+
+// A row of pmu_uncore_traffic: one per HHA, ordered by sccl and index, then one per socket.
+// The HHA counts the requests for the memory behind it, rx_sccl those from another die and
+// rx_outer those from another socket.
+struct PmuUncoreTraffic {
+    int scope;
+    // -1 if unknown; sccl, index and node are -1 on socket rows
+    int socket;
+    int sccl;
+    int index;
+    int node;
+    uint32_t intervalUs;
+    // rx_ops_num, rx_sccl and rx_outer of the interval
+    uint64_t ops;
+    uint64_t scclOps;
+    uint64_t outerOps;
+    // shares of ops, 0 without requests
+    double scclRatio;
+    double outerRatio;
+    // each request moves one cache line
+    double bytesPerSec;
+    double scclBytesPerSec;
+    double outerBytesPerSec;
+};
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,13 +11,126 @@
  ******************************************************************************/
 #ifndef THREAD_INFO_H
 #define THREAD_INFO_H
-#include <string>
+#include <stddef.h>
+#include <stdint.h>
 
-const int THREAD_NUM = 65536;
+/* TASK_COMM_LEN, including the terminating NUL. */
+#define THREAD_NAME_LEN 16
+/* Plain old data, so the published array can be copied with memcpy or shared. */
 struct ThreadInfo {
     int pid;
     int tid;
-    std::string name;
+    char name[THREAD_NAME_LEN];
 };
 
-#endif // !THREAD_INFO_H
\ No newline at end of file
+/* thread_collector publishes ThreadInfo[len] followed by a ThreadIndex, a read-only
+ * open addressing table from tid to the position in the array. It lives in the same
+ * slot memory, so it is valid exactly as long as the snapshot.
+ */
+#define THREAD_INDEX_MAGIC 0x54494458u
+#define THREAD_INDEX_EMPTY (-1)
+struct ThreadIndex {
+    uint32_t magic;
+    /* 32 - log2(bucket count), for the Fibonacci hash. */
+    uint32_t shift;
+    uint32_t mask;
+    int32_t slot[];
+};
+
+static inline const struct ThreadIndex *thread_index_get(const struct ThreadInfo *infos, int len)
+{
+    const struct ThreadIndex *index = (const struct ThreadIndex *)(infos + len);
+    return index->magic == THREAD_INDEX_MAGIC ? index : NULL;
+}
+
+/* Returns the thread with tid in a thread_collector snapshot, or NULL. infos and len
+ * are the data and len of its DataBuf.
+ */
+static inline const struct ThreadInfo *thread_info_find(const struct ThreadInfo *infos, int len, int tid)
+{
+    const struct ThreadIndex *index = thread_index_get(infos, len);
+    uint32_t i;
+
+    if (index == NULL || tid <= 0) {
+        return NULL;
+    }
+    for (i = ((uint32_t)tid * 0x9e3779b1u) >> index->shift;; i = (i + 1) & index->mask) {
+        int32_t slot = index->slot[i];
+        if (slot == THREAD_INDEX_EMPTY) {
+            return NULL;
+        }
+        if (infos[slot].tid == tid) {
+            return &infos[slot];
+        }
+    }
+}
+
+enum ThreadEventType {
+    THREAD_ADDED,
+    THREAD_EXITED,
+    THREAD_RENAMED,
+};
+/* Published by thread_collector_delta. seq increases by one per event, so a gap
+ * means the consumer fell behind the ring.
+ */
+struct ThreadEvent {
+    uint64_t seq;
+    int type;
+    struct ThreadInfo info;
+};
+
+/* Published by thread_sched_collector, all counters are deltas over the interval. */
+struct ThreadSchedInfo {
+    int pid;
+    int tid;
+    /* The CPU the thread last ran on. */
+    int cpu;
+    uint32_t voluntary_switches;
+    uint32_t involuntary_switches;
+    uint64_t utime_ns;
+    uint64_t stime_ns;
+    /* Time spent on the CPU and waiting on a run queue, from schedstat. */
+    uint64_t run_ns;
+    uint64_t wait_ns;
+};
+
+#define PROCESS_CMDLINE_LEN 256
+#define PROCESS_CGROUP_LEN 128
+/* Published by thread_collector_proc, sorted by pid. The attributes are read when the
+ * process is first seen and again only after it execs or its pid is reused.
+ */
+struct ProcessInfo {
+    int pid;
+    /* Number of threads of the process in the thread_collector table. */
+    int thread_num;
+    /* In clock ticks since boot, tells a reused pid apart. */
+    uint64_t start_time;
+    /* Nodes the process may allocate memory on (Mems_allowed_list), bit n is node n. */
+    uint64_t mems_allowed;
+    /* Arguments separated by spaces, truncated. Empty for kernel threads. */
+    char cmdline[PROCESS_CMDLINE_LEN];
+    /* The cgroup v2 path, or the first hierarchy on cgroup v1. */
+    char cgroup[PROCESS_CGROUP_LEN];
+};
+
+/* Returns the process with pid in a thread_collector_proc snapshot, or NULL. */
+static inline const struct ProcessInfo *process_info_find(const struct ProcessInfo *infos, int len, int pid)
+{
+    int lo = 0;
+    int hi = len - 1;
+
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (infos[mid].pid == pid) {
+            return &infos[mid];
+        }
+        if (infos[mid].pid < pid) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+#endif // !THREAD_INFO_H
@@ -10,126 +10,282 @@
  * See the Mulan PSL v2 for more details.
  ******************************************************************************/
 #include "interface.h"
-#include "plugin_sampling.h"
-#include "plugin_counting.h"
-#include "plugin_uncore.h"
-#include "plugin_spe.h"
-#include "plugin_netif_rx.h"
-#include "plugin_napi_gro_receive_entry.h"
-#include "plugin_skb_copy_datagram_iovec.h"
+#include "pmu_plugin.h"
+#include "plugin_comm.h"
+#include "pmu_engine.h"
+#include "pmu_uncore.h"
+#include "pmu_metrics.h"
+#include "pmu_top.h"
+#include "pmu_heatmap.h"
+#include "pmu_traffic.h"
 
-#define INS_COLLECTOR_MAX 10
+#define PMU_RUN_PERIOD       100
+/* cycles, net:netif_rx and the derived metrics events are opened and read together. */
+#define PMU_COUNTING_GROUP   1
+/* The raw cycles samples and their top-N share one sampling session. */
+#define PMU_SAMPLING_GROUP   2
+/* The raw SPE records and their heatmap, SPE allows one session per cpu anyway. */
+#define PMU_SPE_GROUP        3
+/* The uncore counts of every unit type and the HHA traffic derived from them, a unit counts
+ * for one session only.
+ */
+#define PMU_UNCORE_GROUP     4
 
-static struct Interface ins_collector[INS_COLLECTOR_MAX] = {0};
-
-struct Interface sampling_collector = {
-    .get_version = sampling_get_version,
-    .get_description = sampling_get_description,
-    .get_priority = sampling_get_priority,
-    .get_type = sampling_get_type,
-    .get_dep = sampling_get_dep,
-    .get_name = sampling_get_name,
-    .get_period = sampling_get_period,
-    .enable = sampling_enable,
-    .disable = sampling_disable,
-    .get_ring_buf = sampling_get_ring_buf,
-    .run = sampling_run,
+/* Every pmu instance. A new one only needs an entry here. */
+static const struct pmu_instance_desc pmu_descs[] = {
+    {
+        .name = PMU_CYCLES_SAMPLING,
+        .task_type = SAMPLING,
+        .evt_list = {"cycles"},
+        .evt_num = 1,
+        .freq = 100,
+        .use_freq = true,
+        .symbol_mode = RESOLVE_ELF,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_PAUSED,
+        .group = PMU_SAMPLING_GROUP,
+    },
+    {
+        .name = PMU_CYCLES_COUNTING,
+        .task_type = COUNTING,
+        .evt_list = {"cycles"},
+        .evt_num = 1,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_CONTINUOUS,
+        .group = PMU_COUNTING_GROUP,
+    },
+    {
+        .name = PMU_UNCORE,
+        .task_type = COUNTING,
+        // opened on every unit of the type that lists the event, units in the name order the
+        // consumers of this instance index by
+        .evt_list = {"hha/rx_outer", "hha/rx_sccl", "hha/rx_ops_num"},
+        .evt_num = 3,
+        .get_events = uncore_get_events_by_name,
+        .put_events = uncore_put_events,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_CONTINUOUS,
+        .group = PMU_UNCORE_GROUP,
+    },
+    {
+        .name = PMU_SPE,
+        .task_type = SPE_SAMPLING,
+        .period = 2048,
+        .data_filter = SPE_DATA_ALL,
+        .ev_filter = SPE_EVENT_RETIRED,
+        .min_latency = 0x60,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        // while using PMU_SPE, PmuRead internally calls PmuEnable and PmuDisable
+        .read_mode = PMU_READ_DIRECT,
+        .group = PMU_SPE_GROUP,
+    },
+    {
+        .name = PMU_NETIF_RX,
+        .task_type = COUNTING,
+        .evt_list = {"net:netif_rx"},
+        .evt_num = 1,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_CONTINUOUS,
+        .group = PMU_COUNTING_GROUP,
+    },
+    {
+        .name = PMU_NAPI_GRO_REC_ENTRY,
+        .description = "event used to collect net queue info",
+        .task_type = SAMPLING,
+        .evt_list = {"net:napi_gro_receive_entry"},
+        .evt_num = 1,
+        .period = NET_RECEIVE_TRACE_SAMPLE_PERIOD,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_PAUSED,
+    },
+    {
+        .name = PMU_SKB_COPY_DATEGRAM_IOVEC,
+        .description = "event used to collect recv skb addr info",
+        .task_type = SAMPLING,
+        .evt_list = {"skb:skb_copy_datagram_iovec"},
+        .evt_num = 1,
+        .period = NET_RECEIVE_TRACE_SAMPLE_PERIOD,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_PAUSED,
+    },
+    {
+        .name = PMU_DERIVED_METRICS,
+        .description = "per cpu ipc, mpki and event rates, see struct PmuCpuMetrics",
+        .task_type = COUNTING,
+        // in the order of enum metrics_event
+        .evt_list = {"cycles", "instructions", "cache-misses", "branch-misses"},
+        .evt_num = METRICS_EVENT_MAX,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_CONTINUOUS,
+        .group = PMU_COUNTING_GROUP,
+        .transform = pmu_metrics_derive,
+    },
+    {
+        .name = PMU_CYCLES_SAMPLING_TOP,
+        .description = "hottest functions per interval by cycles samples, see struct PmuSymbolTop",
+        .task_type = SAMPLING,
+        .evt_list = {"cycles"},
+        .evt_num = 1,
+        .freq = 100,
+        .use_freq = true,
+        .symbol_mode = RESOLVE_ELF,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_PAUSED,
+        .group = PMU_SAMPLING_GROUP,
+        .transform = pmu_top_aggregate,
+        .out_limit = PMU_TOP_DEFAULT_N,
+    },
+    {
+        .name = PMU_SPE_HEATMAP,
+        .description = "hottest pages and per node access latency of SPE records, see struct PmuSpeHeatmap",
+        .task_type = SPE_SAMPLING,
+        .period = 2048,
+        .data_filter = SPE_DATA_ALL,
+        .ev_filter = SPE_EVENT_RETIRED,
+        .min_latency = 0x60,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_DIRECT,
+        .group = PMU_SPE_GROUP,
+        .transform = pmu_heatmap_aggregate,
+        .out_limit = PMU_HEATMAP_DEFAULT_PAGES,
+    },
+    {
+        .name = PMU_UNCORE_MEM,
+        .description = "ddrc, l3c and pa uncore counts of every unit",
+        .task_type = COUNTING,
+        .evt_list = {"ddrc/flux_rd", "ddrc/flux_wr", "l3c/rd_cpipe", "l3c/rd_hit_cpipe", "pa/rx_req", "pa/tx_req"},
+        .evt_num = 6,
+        .get_events = uncore_get_events,
+        .put_events = uncore_put_events,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_CONTINUOUS,
+        .group = PMU_UNCORE_GROUP,
+    },
+    {
+        .name = PMU_UNCORE_TRAFFIC,
+        .description = "per HHA and per socket remote access ratios and bandwidth, see struct PmuUncoreTraffic",
+        .task_type = COUNTING,
+        .evt_list = {"hha/rx_outer", "hha/rx_sccl", "hha/rx_ops_num"},
+        .evt_num = 3,
+        .get_events = uncore_get_events,
+        .put_events = uncore_put_events,
+        .buf_size = PMU_BUF_SIZE,
+        .run_period = PMU_RUN_PERIOD,
+        .read_mode = PMU_READ_CONTINUOUS,
+        .group = PMU_UNCORE_GROUP,
+        .transform = pmu_traffic_derive,
+    },
 };
 
-struct Interface counting_collector = {
-    .get_version = counting_get_version,
-    .get_description = counting_get_description,
-    .get_priority = counting_get_priority,
-    .get_type = counting_get_type,
-    .get_dep = counting_get_dep,
-    .get_name = counting_get_name,
-    .get_period = counting_get_period,
-    .enable = counting_enable,
-    .disable = counting_disable,
-    .get_ring_buf = counting_get_ring_buf,
-    .run = counting_run,
-};
+static const char *pmu_get_version()
+{
+    return NULL;
+}
 
-struct Interface uncore_collector = {
-    .get_version = uncore_get_version,
-    .get_description = uncore_get_description,
-    .get_priority = uncore_get_priority,
-    .get_type = uncore_get_type,
-    .get_dep = uncore_get_dep,
-    .get_name = uncore_get_name,
-    .get_period = uncore_get_period,
-    .enable = uncore_enable,
-    .disable = uncore_disable,
-    .get_ring_buf = uncore_get_ring_buf,
-    .run = uncore_run,
-};
+static const char *pmu_get_dep()
+{
+    return NULL;
+}
 
-struct Interface spe_collector = {
-    .get_version = spe_get_version,
-    .get_description = spe_get_description,
-    .get_priority = spe_get_priority,
-    .get_type = spe_get_type,
-    .get_dep = spe_get_dep,
-    .get_name = spe_get_name,
-    .get_period = spe_get_period,
-    .enable = spe_enable,
-    .disable = spe_disable,
-    .get_ring_buf = spe_get_ring_buf,
-    .run = spe_run,
-};
+static int pmu_get_priority()
+{
+    return 0;
+}
 
-struct Interface netif_rx_collector = {
-    .get_version = netif_rx_get_version,
-    .get_description = netif_rx_get_description,
-    .get_priority = netif_rx_get_priority,
-    .get_type = netif_rx_get_type,
-    .get_dep = netif_rx_get_dep,
-    .get_name = netif_rx_get_name,
-    .get_period = netif_rx_get_period,
-    .enable = netif_rx_enable,
-    .disable = netif_rx_disable,
-    .get_ring_buf = netif_rx_get_ring_buf,
-    .run = netif_rx_run,
-};
+static int pmu_get_type()
+{
+    return -1;
+}
 
-struct Interface g_napiGroRecEntryCollector = {
-    .get_version = NapiGroRecEntryGetVer,
-    .get_description = NapiGroRecEntryGetDes,
-    .get_priority = NapiGroRecEntryGetPriority,
-    .get_type = NapiGroRecEntryGetType,
-    .get_dep = NapiGroRecEntryGetDep,
-    .get_name = NapiGroRecEntryGetName,
-    .get_period = NapiGroRecEntryGetPeriod,
-    .enable = NapiGroRecEntryEnable,
-    .disable = NapiGroRecEntryDisable,
-    .get_ring_buf = NapiGroRecEntryGetBuf,
-    .run = NapiGroRecEntryRun,
-};
+/* The interface callbacks take no instance argument, so each table index gets its own. */
+#define PMU_INSTANCE_CALLBACKS(i) \
+static const char *pmu_get_name_##i() \
+{ \
+    return pmu_engine_get_name(i); \
+} \
+static const char *pmu_get_description_##i() \
+{ \
+    return pmu_engine_get_description(i); \
+} \
+static int pmu_get_period_##i() \
+{ \
+    return pmu_engine_get_period(i); \
+} \
+static bool pmu_enable_##i() \
+{ \
+    return pmu_engine_enable(i); \
+} \
+static void pmu_disable_##i() \
+{ \
+    pmu_engine_disable(i); \
+} \
+static const struct DataRingBuf *pmu_get_ring_buf_##i() \
+{ \
+    return pmu_engine_get_ring_buf(i); \
+} \
+static void pmu_run_##i(const struct Param *param) \
+{ \
+    (void)param; \
+    pmu_engine_run(i); \
+}
 
-struct Interface g_skbCopyDatagramIovecCollector = {
-    .get_version = SkbCopyDatagramIovecGetVer,
-    .get_description = SkbCopyDatagramIovecGetDes,
-    .get_priority = SkbCopyDatagramIovecGetPriority,
-    .get_type = SkbCopyDatagramIovecGetType,
-    .get_dep = SkbCopyDatagramIovecGetDep,
-    .get_name = SkbCopyDatagramIovecGetName,
-    .get_period = SkbCopyDatagramIovecGetPeriod,
-    .enable = SkbCopyDatagramIovecEnable,
-    .disable = SkbCopyDatagramIovecDisable,
-    .get_ring_buf = SkbCopyDatagramIovecGetBuf,
-    .run = SkbCopyDatagramIovecRun,
+#define PMU_INSTANCE_INTERFACE(i) { \
+    .get_version = pmu_get_version, \
+    .get_description = pmu_get_description_##i, \
+    .get_priority = pmu_get_priority, \
+    .get_type = pmu_get_type, \
+    .get_dep = pmu_get_dep, \
+    .get_name = pmu_get_name_##i, \
+    .get_period = pmu_get_period_##i, \
+    .enable = pmu_enable_##i, \
+    .disable = pmu_disable_##i, \
+    .get_ring_buf = pmu_get_ring_buf_##i, \
+    .run = pmu_run_##i, \
+}
+
+PMU_INSTANCE_CALLBACKS(0)
+PMU_INSTANCE_CALLBACKS(1)
+PMU_INSTANCE_CALLBACKS(2)
+PMU_INSTANCE_CALLBACKS(3)
+PMU_INSTANCE_CALLBACKS(4)
+PMU_INSTANCE_CALLBACKS(5)
+PMU_INSTANCE_CALLBACKS(6)
+PMU_INSTANCE_CALLBACKS(7)
+PMU_INSTANCE_CALLBACKS(8)
+PMU_INSTANCE_CALLBACKS(9)
+PMU_INSTANCE_CALLBACKS(10)
+PMU_INSTANCE_CALLBACKS(11)
+
+static struct Interface ins_collector[PMU_INSTANCE_MAX] = {
+    PMU_INSTANCE_INTERFACE(0),
+    PMU_INSTANCE_INTERFACE(1),
+    PMU_INSTANCE_INTERFACE(2),
+    PMU_INSTANCE_INTERFACE(3),
+    PMU_INSTANCE_INTERFACE(4),
+    PMU_INSTANCE_INTERFACE(5),
+    PMU_INSTANCE_INTERFACE(6),
+    PMU_INSTANCE_INTERFACE(7),
+    PMU_INSTANCE_INTERFACE(8),
+    PMU_INSTANCE_INTERFACE(9),
+    PMU_INSTANCE_INTERFACE(10),
+    PMU_INSTANCE_INTERFACE(11),
 };
+
 int get_instance(struct Interface **interface)
 {
-    int ins_count = 0;
+    int ins_count = pmu_engine_init(pmu_descs, sizeof(pmu_descs) / sizeof(pmu_descs[0]));
 
-    ins_collector[ins_count++] = sampling_collector;
-    ins_collector[ins_count++] = counting_collector;
-    ins_collector[ins_count++] = uncore_collector;
-    ins_collector[ins_count++] = spe_collector;
-    ins_collector[ins_count++] = netif_rx_collector;
-    ins_collector[ins_count++] = g_napiGroRecEntryCollector;
-    ins_collector[ins_count++] = g_skbCopyDatagramIovecCollector;
     *interface = &ins_collector[0];
 
     return ins_count;
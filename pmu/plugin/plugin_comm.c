@@ -15,70 +15,126 @@
 #include <securec.h>
 #include "pmu.h"
 #include "interface.h"
+#include "pmu_plugin.h"
+#include "plugin_comm.h"
+
+static struct PmuRingBuf *to_pmu_ring(struct DataRingBuf *data_ringbuf)
+{
+    return (struct PmuRingBuf *)data_ringbuf;
+}
+
+void pmu_data_free(void *data)
+{
+    PmuDataFree((struct PmuData *)data);
+}
 
 struct DataRingBuf *init_buf(int buf_len, const char *instance_name)
 {
+    struct PmuRingBuf *pmu_ring;
     struct DataRingBuf *data_ringbuf;
 
-    data_ringbuf = (struct DataRingBuf *)malloc(sizeof(struct DataRingBuf));
-    if (!data_ringbuf) {
+    pmu_ring = (struct PmuRingBuf *)malloc(sizeof(struct PmuRingBuf));
+    if (!pmu_ring) {
         printf("malloc data_ringbuf failed\n");
         return NULL;
     }
 
-    (void)memset_s(data_ringbuf, sizeof(struct DataRingBuf), 0, sizeof(struct DataRingBuf));
-    
+    (void)memset_s(pmu_ring, sizeof(struct PmuRingBuf), 0, sizeof(struct PmuRingBuf));
+    pmu_ring->magic = PMU_RING_MAGIC;
+    data_ringbuf = &pmu_ring->ring;
+
     data_ringbuf->instance_name = instance_name;
     data_ringbuf->index = -1;
 
     data_ringbuf->buf = (struct DataBuf *)malloc(sizeof(struct DataBuf) * buf_len);
-    if (!data_ringbuf->buf) {
+    pmu_ring->slots = (struct PmuSlotRef **)malloc(sizeof(struct PmuSlotRef *) * buf_len);
+    if (!data_ringbuf->buf || !pmu_ring->slots) {
         printf("malloc data_ringbuf buf failed\n");
-        free(data_ringbuf);
-        data_ringbuf = NULL;
+        free(data_ringbuf->buf);
+        free(pmu_ring->slots);
+        free(pmu_ring);
+        pmu_ring = NULL;
         return NULL;
     }
 
     (void)memset_s(data_ringbuf->buf, sizeof(struct DataBuf) * buf_len, 0, sizeof(struct DataBuf) * buf_len);
+    (void)memset_s(pmu_ring->slots, sizeof(struct PmuSlotRef *) * buf_len, 0, sizeof(struct PmuSlotRef *) * buf_len);
     data_ringbuf->buf_len = buf_len;
 
     return data_ringbuf;
 }
 
+/* Puts ref into slot index and drops the reference of the ring on the buffer it replaces,
+ * which is freed now or by its last reader.
+ */
+static void replace_slot(struct PmuRingBuf *pmu_ring, int index, struct PmuSlotRef *ref)
+{
+    struct PmuSlotRef *old;
+
+    old = __atomic_exchange_n(&pmu_ring->slots[index], ref, __ATOMIC_SEQ_CST);
+    // A reader that loaded old has not taken its reference yet.
+    while (__atomic_load_n(&pmu_ring->acquiring, __ATOMIC_SEQ_CST) != 0) {
+    }
+    PmuRingRelease(old);
+}
+
 void free_buf(struct DataRingBuf *data_ringbuf)
 {
+    struct PmuRingBuf *pmu_ring;
+
     if (!data_ringbuf) {
         return;
     }
+    pmu_ring = to_pmu_ring(data_ringbuf);
 
-    if (!data_ringbuf->buf) {
-        goto out;
+    if (pmu_ring->slots) {
+        for (int i = 0; i < data_ringbuf->buf_len; i++) {
+            replace_slot(pmu_ring, i, NULL);
+        }
+        free(pmu_ring->slots);
+        pmu_ring->slots = NULL;
     }
 
     free(data_ringbuf->buf);
     data_ringbuf->buf = NULL;
-
-out:
-    free(data_ringbuf);
+    free(pmu_ring);
     data_ringbuf = NULL;
 }
 
-void fill_buf(struct DataRingBuf *data_ringbuf, struct PmuData *pmu_data, int len)
+void fill_buf_data(struct DataRingBuf *data_ringbuf, void *data, int len, data_free_fn free_data)
 {
+    struct PmuSlotRef *ref = NULL;
     struct DataBuf *buf;
     int index;
 
+    if (data != NULL) {
+        ref = (struct PmuSlotRef *)malloc(sizeof(struct PmuSlotRef));
+        if (!ref) {
+            printf("malloc slot ref failed\n");
+            if (free_data != NULL) {
+                free_data(data);
+            }
+            data = NULL;
+            len = 0;
+        } else {
+            ref->refs = 1;
+            ref->len = len;
+            ref->data = data;
+            ref->freeData = free_data;
+        }
+    }
+
     index = (data_ringbuf->index + 1) % data_ringbuf->buf_len;
-    data_ringbuf->index = index;
-    data_ringbuf->count++;
     buf = &data_ringbuf->buf[index];
+    replace_slot(to_pmu_ring(data_ringbuf), index, ref);
+    buf->len = len;
+    buf->data = data;
 
-    if (buf->data != NULL) {
-        PmuDataFree(buf->data);
-        buf->data = NULL;
-        buf->len = 0;
-    }
+    data_ringbuf->count++;
+    __atomic_store_n(&data_ringbuf->index, index, __ATOMIC_RELEASE);
+}
 
-    buf->len = len;
-    buf->data = (void *)pmu_data;
+void fill_buf(struct DataRingBuf *data_ringbuf, struct PmuData *pmu_data, int len)
+{
+    fill_buf_data(data_ringbuf, (void *)pmu_data, len, pmu_data_free);
 }
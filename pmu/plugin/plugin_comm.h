@@ -16,21 +16,22 @@
 extern "C" {
 #endif
 
-#define CYCLES_COUNTING_BUF_SIZE         10
-#define CYCLES_SAMPLING_BUF_SIZE         10
-#define UNCORE_BUF_SIZE                  10
-#define SPE_BUF_SIZE                     10
-#define NETIF_RX_BUF_SIZE                10
-#define NAPI_GRO_REC_ENTRY_BUF_SIZE      10
-#define SKB_COPY_DATAGRAM_IOVEC_BUF_SIZE 10
+#define PMU_BUF_SIZE                     10
 #define NET_RECEIVE_TRACE_SAMPLE_PERIOD  10
 
 struct DataRingBuf;
 struct PmuData;
 
+/* Releases the data of a ring slot when it is overwritten or the ring is freed. */
+typedef void (*data_free_fn)(void *data);
+
 struct DataRingBuf *init_buf(int buf_len, const char *instance_name);
 void free_buf(struct DataRingBuf *data_ringbuf);
+/* data_free_fn for a PmuRead result. */
+void pmu_data_free(void *data);
+/* Publishes a PmuRead result, which is released with PmuDataFree. */
 void fill_buf(struct DataRingBuf *data_ringbuf, struct PmuData *pmu_data, int len);
+void fill_buf_data(struct DataRingBuf *data_ringbuf, void *data, int len, data_free_fn free_data);
 
 #ifdef __cplusplus
 }
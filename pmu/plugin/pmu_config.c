@@ -0,0 +1,321 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <securec.h>
+#include "pmu_plugin.h"
+#include "pmu_engine.h"
+#include "pmu_config.h"
+
+#define CONFIG_LINE_LEN      1024
+#define MAX_SAMPLE_FREQ      100000
+#define MIN_RUN_PERIOD       10
+#define MAX_RUN_PERIOD       3600000
+#define MAX_MIN_LATENCY      0xffff
+#define MAX_TOP_N            100000
+#define MAX_SAMPLE_BUDGET    10000000
+#define CHECK_INTERVAL_MS    1000
+
+// What the loaded file looked like, a change of any field means it was rewritten.
+struct config_stamp {
+    bool exists;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+};
+
+static char conf_evts[PMU_INSTANCE_MAX][PMU_EVT_MAX][PMU_EVT_NAME_LEN];
+static int reload_pending = 0;
+static struct config_stamp loaded_stamp;
+static int64_t last_check_ms = 0;
+
+static char *trim(char *s)
+{
+    char *end;
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+        end--;
+    }
+    *end = '\0';
+
+    return s;
+}
+
+static int parse_ulong(const char *value, unsigned long min, unsigned long max, unsigned long *out)
+{
+    char *end = NULL;
+    unsigned long n;
+
+    if (*value == '\0' || *value == '-') {
+        return -1;
+    }
+    errno = 0;
+    n = strtoul(value, &end, 0);
+    if (errno != 0 || *end != '\0' || n < min || n > max) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static int parse_events(int index, char *value, struct pmu_instance_desc *desc)
+{
+    char *save = NULL;
+    int num = 0;
+
+    for (char *evt = strtok_r(value, ",", &save); evt != NULL; evt = strtok_r(NULL, ",", &save)) {
+        evt = trim(evt);
+        if (*evt == '\0') {
+            continue;
+        }
+        if (num == PMU_EVT_MAX || strlen(evt) >= PMU_EVT_NAME_LEN) {
+            return -1;
+        }
+        (void)strcpy_s(conf_evts[index][num], PMU_EVT_NAME_LEN, evt);
+        num++;
+    }
+    if (num == 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < num; i++) {
+        desc->evt_list[i] = conf_evts[index][i];
+    }
+    desc->evt_num = num;
+
+    return 0;
+}
+
+static int apply_setting(int index, const char *key, char *value, struct pmu_instance_desc *desc)
+{
+    unsigned long n;
+
+    if (strcmp(key, "events") == 0) {
+        return parse_events(index, value, desc);
+    }
+
+    if (strcmp(key, "freq") == 0) {
+        if (desc->task_type != SAMPLING || parse_ulong(value, 1, MAX_SAMPLE_FREQ, &n) != 0) {
+            return -1;
+        }
+        desc->freq = (unsigned)n;
+        desc->use_freq = true;
+    } else if (strcmp(key, "period") == 0) {
+        if (desc->task_type == COUNTING || parse_ulong(value, 1, UINT32_MAX, &n) != 0) {
+            return -1;
+        }
+        desc->period = (unsigned)n;
+        desc->use_freq = false;
+    } else if (strcmp(key, "min_latency") == 0) {
+        if (desc->task_type != SPE_SAMPLING || parse_ulong(value, 0, MAX_MIN_LATENCY, &n) != 0) {
+            return -1;
+        }
+        desc->min_latency = n;
+    } else if (strcmp(key, "sample_budget") == 0) {
+        if (desc->task_type != SPE_SAMPLING || parse_ulong(value, 0, MAX_SAMPLE_BUDGET, &n) != 0) {
+            return -1;
+        }
+        desc->sample_budget = (unsigned)n;
+    } else if (strcmp(key, "read_mode") == 0) {
+        // SPE has to be read directly, sampling keeps the pause around the read.
+        if (desc->task_type != COUNTING) {
+            return -1;
+        }
+        if (strcmp(value, "continuous") == 0) {
+            desc->read_mode = PMU_READ_CONTINUOUS;
+        } else if (strcmp(value, "paused") == 0) {
+            desc->read_mode = PMU_READ_PAUSED;
+        } else {
+            return -1;
+        }
+    } else if (strcmp(key, "symbol_mode") == 0) {
+        if (desc->task_type != SAMPLING) {
+            return -1;
+        }
+        if (strcmp(value, "raw") == 0) {
+            desc->symbol_mode = NO_SYMBOL_RESOLVE;
+        } else if (strcmp(value, "elf") == 0) {
+            desc->symbol_mode = RESOLVE_ELF;
+        } else {
+            return -1;
+        }
+    } else if (strcmp(key, "top_n") == 0) {
+        if (desc->transform == NULL || parse_ulong(value, 1, MAX_TOP_N, &n) != 0) {
+            return -1;
+        }
+        desc->out_limit = (int)n;
+    } else if (strcmp(key, "run_period") == 0) {
+        if (parse_ulong(value, MIN_RUN_PERIOD, MAX_RUN_PERIOD, &n) != 0) {
+            return -1;
+        }
+        desc->run_period = (int)n;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int find_instance(const struct pmu_instance_desc *descs, int num, const char *name)
+{
+    for (int i = 0; i < num; i++) {
+        if (strcmp(descs[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void parse_line(const char *path, int line_no, char *line, struct pmu_instance_desc *descs, int num)
+{
+    char *value;
+    char *key;
+    int index;
+
+    line = trim(line);
+    if (*line == '\0' || *line == '#') {
+        return;
+    }
+
+    value = strchr(line, '=');
+    if (value == NULL) {
+        goto err;
+    }
+    *value++ = '\0';
+    // Instance names hold no dot but values may, so look for it in the key half only.
+    key = strrchr(line, '.');
+    if (key == NULL) {
+        goto err;
+    }
+    *key++ = '\0';
+    key = trim(key);
+    value = trim(value);
+
+    index = find_instance(descs, num, trim(line));
+    if (index < 0 || apply_setting(index, key, value, &descs[index]) != 0) {
+        goto err;
+    }
+
+    return;
+
+err:
+    printf("%s:%d: invalid pmu config, ignored\n", path, line_no);
+}
+
+static const char *config_path(void)
+{
+    const char *path = getenv(PMU_CONFIG_ENV);
+
+    if (path == NULL || *path == '\0') {
+        path = PMU_CONFIG_PATH;
+    }
+
+    return path;
+}
+
+static void get_stamp(const char *path, struct config_stamp *stamp)
+{
+    struct stat st;
+
+    (void)memset_s(stamp, sizeof(*stamp), 0, sizeof(*stamp));
+    if (stat(path, &st) != 0) {
+        return;
+    }
+    stamp->exists = true;
+    stamp->dev = st.st_dev;
+    stamp->ino = st.st_ino;
+    stamp->size = st.st_size;
+    stamp->mtime = st.st_mtim;
+}
+
+static bool same_stamp(const struct config_stamp *a, const struct config_stamp *b)
+{
+    if (!a->exists || !b->exists) {
+        return a->exists == b->exists;
+    }
+
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+        a->mtime.tv_sec == b->mtime.tv_sec && a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void pmu_config_load(const struct pmu_instance_desc *base, struct pmu_instance_desc *out, int num)
+{
+    char line[CONFIG_LINE_LEN];
+    const char *path = config_path();
+    FILE *file;
+    int line_no = 0;
+
+    for (int i = 0; i < num; i++) {
+        out[i] = base[i];
+    }
+
+    // Stamped before reading, a write racing the read is then seen by the next check.
+    get_stamp(path, &loaded_stamp);
+    last_check_ms = now_ms();
+    file = fopen(path, "r");
+    if (file == NULL) {
+        if (errno != ENOENT) {
+            printf("open %s failed: %s\n", path, strerror(errno));
+        }
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        parse_line(path, ++line_no, line, out, num);
+    }
+
+    fclose(file);
+}
+
+void PmuReloadConfig(void)
+{
+    __atomic_store_n(&reload_pending, 1, __ATOMIC_RELEASE);
+}
+
+bool pmu_config_reload_pending(void)
+{
+    struct config_stamp stamp;
+    int64_t now;
+
+    if (__atomic_exchange_n(&reload_pending, 0, __ATOMIC_ACQ_REL) != 0) {
+        return true;
+    }
+
+    now = now_ms();
+    if (now - last_check_ms < CHECK_INTERVAL_MS) {
+        return false;
+    }
+    last_check_ms = now;
+    get_stamp(config_path(), &stamp);
+
+    return !same_stamp(&stamp, &loaded_stamp);
+}
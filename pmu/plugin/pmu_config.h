@@ -0,0 +1,64 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PMU_CONFIG_H__
+#define __PMU_CONFIG_H__
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PMU_CONFIG_PATH      "/etc/oeAware/pmu_plugin.conf"
+#define PMU_CONFIG_ENV       "PMU_PLUGIN_CONFIG"
+#define PMU_EVT_NAME_LEN     128
+
+struct pmu_instance_desc;
+
+/*
+ * The config file overrides the descriptor table per instance, one setting per line:
+ *   # comment
+ *   pmu_cycles_sampling.freq = 50
+ *   pmu_spe_sampling.period = 4096
+ *   pmu_spe_sampling.min_latency = 0x60
+ *   pmu_spe_sampling.sample_budget = 20000
+ *   pmu_cycles_counting.events = cycles,instructions
+ *   pmu_netif_rx_counting.run_period = 1000
+ *   pmu_uncore_counting.read_mode = paused
+ *   pmu_uncore_mem_counting.events = ddrc/flux_rd,ddrc/flux_wr
+ *   pmu_cycles_sampling_top.top_n = 32
+ *   pmu_cycles_sampling.symbol_mode = raw
+ * The path is PMU_CONFIG_PATH unless PMU_CONFIG_ENV is set. A missing file keeps the
+ * table values, a bad line is reported and skipped. The file is reloaded once it is
+ * created, rewritten or removed, checked at most once a second, or when the host calls
+ * PmuReloadConfig.
+ * The events of the uncore instances are "<unit type>/<event>", opened on every unit of the
+ * type: pmu_uncore_counting keeps the hha events by default, pmu_uncore_mem_counting those of
+ * ddrc, l3c and pa.
+ * symbol_mode = raw leaves the samples unresolved, see PmuResolveSymbol. Grouped instances
+ * share one session only while their symbol_mode is the same.
+ */
+
+/* Fills out[i] with base[i] and the overrides of the file. The event names of out stay
+ * valid until the next load.
+ */
+void pmu_config_load(const struct pmu_instance_desc *base, struct pmu_instance_desc *out, int num);
+/* Returns true once per PmuReloadConfig call, or once for several made in between, and
+ * when the file has changed since the last load. Called from the engine's run.
+ */
+bool pmu_config_reload_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
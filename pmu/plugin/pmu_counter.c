@@ -0,0 +1,126 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "pmu.h"
+#include "pmu_counter.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/* Event names are hashed so the previous read does not have to be kept alive. */
+static uint64_t evt_hash(const char *evt)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    if (evt == NULL) {
+        return 0;
+    }
+    while (*evt != '\0') {
+        hash = (hash ^ (unsigned char)*evt++) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static bool counter_match(const struct pmu_counter *counter, uint64_t hash, const struct PmuData *data)
+{
+    return counter->evt_hash == hash && counter->cpu == data->cpu && counter->tid == data->tid;
+}
+
+/* PmuRead returns the counters in the same order every time, so the entry at the same
+ * index is checked first and the others only after a reopen changed the layout.
+ */
+static const struct pmu_counter *find_last(const struct pmu_counters *counters, int index, uint64_t hash,
+    const struct PmuData *data)
+{
+    if (index < counters->len && counter_match(&counters->last[index], hash, data)) {
+        return &counters->last[index];
+    }
+
+    for (int i = 0; i < counters->len; i++) {
+        if (counter_match(&counters->last[i], hash, data)) {
+            return &counters->last[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int reserve(struct pmu_counters *counters, int len)
+{
+    struct pmu_counter *last;
+    struct pmu_counter *next;
+
+    if (len <= counters->cap) {
+        return 0;
+    }
+
+    last = (struct pmu_counter *)realloc(counters->last, sizeof(struct pmu_counter) * len);
+    if (last == NULL) {
+        return -1;
+    }
+    counters->last = last;
+    next = (struct pmu_counter *)realloc(counters->next, sizeof(struct pmu_counter) * len);
+    if (next == NULL) {
+        return -1;
+    }
+    counters->next = next;
+    counters->cap = len;
+
+    return 0;
+}
+
+void pmu_counters_delta(struct pmu_counters *counters, struct PmuData *data, int len)
+{
+    struct pmu_counter *next;
+
+    if (reserve(counters, len) != 0) {
+        printf("malloc pmu counters failed\n");
+        return;
+    }
+
+    next = counters->next;
+    for (int i = 0; i < len; i++) {
+        uint64_t hash = evt_hash(data[i].evt);
+        const struct pmu_counter *last = find_last(counters, i, hash, &data[i]);
+
+        next[i].evt_hash = hash;
+        next[i].cpu = data[i].cpu;
+        next[i].tid = data[i].tid;
+        next[i].total = data[i].count;
+        // A total below the last one means the counter was reset, it counts from zero.
+        if (last != NULL && data[i].count >= last->total) {
+            data[i].count -= last->total;
+        }
+    }
+
+    counters->next = counters->last;
+    counters->last = next;
+    counters->len = len;
+}
+
+void pmu_counters_reset(struct pmu_counters *counters)
+{
+    counters->len = 0;
+}
+
+void pmu_counters_free(struct pmu_counters *counters)
+{
+    free(counters->last);
+    free(counters->next);
+    counters->last = NULL;
+    counters->next = NULL;
+    counters->len = 0;
+    counters->cap = 0;
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PMU_COUNTER_H__
+#define __PMU_COUNTER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct PmuData;
+
+struct pmu_counter {
+    uint64_t evt_hash;
+    int cpu;
+    int tid;
+    uint64_t total;
+};
+
+/* The running totals of the last read of a pd that is never stopped. Two buffers are
+ * swapped on every read, so steady reads do not allocate.
+ */
+struct pmu_counters {
+    struct pmu_counter *last;
+    struct pmu_counter *next;
+    int len;
+    int cap;
+};
+
+/* Turns the running totals of data into the counts since the previous read. The first
+ * read after a reset counts from PmuEnable.
+ */
+void pmu_counters_delta(struct pmu_counters *counters, struct PmuData *data, int len);
+/* Forgets the totals, for a reopened pd. */
+void pmu_counters_reset(struct pmu_counters *counters);
+void pmu_counters_free(struct pmu_counters *counters);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
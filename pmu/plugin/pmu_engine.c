@@ -0,0 +1,878 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <securec.h>
+#include "pmu.h"
+#include "pcerrc.h"
+#include "interface.h"
+#include "pmu_plugin.h"
+#include "plugin_comm.h"
+#include "pmu_engine.h"
+#include "pmu_config.h"
+#include "pmu_counter.h"
+#include "pmu_symbol.h"
+
+#define NSEC_PER_MSEC       1000000ULL
+/* sample_budget control: the period follows records / budget outside [LOW, HIGH], by at most
+ * MAX_STEP per change, and only after SETTLE_READS reads at the current period.
+ */
+#define RATE_HIGH           1.25
+#define RATE_LOW            0.5
+#define RATE_MAX_STEP       4.0
+#define RATE_SETTLE_READS   3
+#define RATE_COST_SHARE     4
+#define RATE_PERIOD_MAX     (1U << 24)
+
+/* One PmuRead of a group, kept until the last member slot built from it is released, which
+ * may happen in a reader thread.
+ */
+struct pmu_group_read {
+    struct PmuData *data;
+    int len;
+    int refs;
+    uint64_t read_ns;
+};
+
+/* The slot data of a group member: its own entries of a group read. */
+struct pmu_member_data {
+    struct pmu_group_read *read;
+    struct PmuData data[];
+};
+
+/* The period a session is opened with. A sample_budget moves it away from the configured base. */
+struct pmu_rate {
+    unsigned base;
+    unsigned period;
+    /* Reads since the period last changed. */
+    int reads;
+};
+
+struct pmu_group {
+    int id;
+    int run_period;
+    enum pmu_read_mode read_mode;
+    int pd;
+    struct pmu_counters counters;
+    struct pmu_group_read *read;
+    /* Bumped by every read. A member reads again only once it has taken the current read,
+     * so members running in the same period share one PmuRead.
+     */
+    unsigned long read_seq;
+    struct pmu_rate rate;
+};
+
+struct pmu_instance {
+    /* The table entry with the config file applied. */
+    struct pmu_instance_desc desc;
+    char evt_names[PMU_EVT_MAX][PMU_EVT_NAME_LEN];
+    struct pmu_group *group;
+    struct DataRingBuf *buf;
+    char *evts[PMU_EVT_MAX];
+    char **evt_list;
+    int evt_num;
+    /* The own pd, -1 while the events are read through the group. */
+    int pd;
+    struct pmu_counters counters;
+    struct pmu_rate rate;
+    bool enabled;
+    bool in_group;
+    bool unsupported;
+    unsigned long read_seq;
+    /* The period the framework got at load, runs are skipped for a longer configured one. */
+    int tick_period;
+    int64_t last_run_ms;
+    /* When the counters of the next slot started, and the span of the current slot. */
+    uint64_t last_read_ns;
+    uint64_t interval_ns;
+};
+
+static const struct pmu_instance_desc *base_descs = NULL;
+static struct pmu_instance_desc conf_descs[PMU_INSTANCE_MAX];
+static struct pmu_instance instances[PMU_INSTANCE_MAX];
+static struct pmu_group groups[PMU_INSTANCE_MAX];
+static int instance_num = 0;
+static int group_num = 0;
+
+static struct pmu_group *find_group(const struct pmu_instance_desc *desc)
+{
+    struct pmu_group *group;
+
+    if (desc->group == 0) {
+        return NULL;
+    }
+
+    for (int i = 0; i < group_num; i++) {
+        if (groups[i].id == desc->group && groups[i].run_period == desc->run_period &&
+            groups[i].read_mode == desc->read_mode) {
+            return &groups[i];
+        }
+    }
+
+    group = &groups[group_num++];
+    group->id = desc->group;
+    group->run_period = desc->run_period;
+    group->read_mode = desc->read_mode;
+    group->pd = -1;
+    group->read = NULL;
+    group->read_seq = 0;
+    return group;
+}
+
+/* Copies desc with its event names, which may live in the config parser. */
+static void set_desc(struct pmu_instance *ins, const struct pmu_instance_desc *desc)
+{
+    ins->desc = *desc;
+    for (int i = 0; i < desc->evt_num; i++) {
+        (void)strcpy_s(ins->evt_names[i], PMU_EVT_NAME_LEN, desc->evt_list[i]);
+        ins->desc.evt_list[i] = ins->evt_names[i];
+    }
+}
+
+int pmu_engine_init(const struct pmu_instance_desc *descs, int num)
+{
+    if (instance_num > 0) {
+        return instance_num;
+    }
+
+    if (num > PMU_INSTANCE_MAX) {
+        num = PMU_INSTANCE_MAX;
+    }
+
+    base_descs = descs;
+    pmu_config_load(descs, conf_descs, num);
+    for (int i = 0; i < num; i++) {
+        struct pmu_instance *ins = &instances[i];
+
+        (void)memset_s(ins, sizeof(struct pmu_instance), 0, sizeof(struct pmu_instance));
+        set_desc(ins, &conf_descs[i]);
+        ins->group = find_group(&descs[i]);
+        ins->pd = -1;
+        ins->tick_period = ins->desc.run_period;
+    }
+    instance_num = num;
+
+    return instance_num;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int pmu_open(const struct pmu_instance_desc *desc, unsigned period, char **evt_list, int evt_num)
+{
+    struct PmuAttr attr;
+    int pd;
+
+    (void)memset_s(&attr, sizeof(struct PmuAttr), 0, sizeof(struct PmuAttr));
+
+    attr.evtList = evt_num > 0 ? evt_list : NULL;
+    attr.numEvt = evt_num;
+    attr.pidList = NULL;
+    attr.numPid = 0;
+    attr.cpuList = NULL;
+    attr.numCpu = 0;
+    if (desc->use_freq) {
+        attr.freq = desc->freq;
+        attr.useFreq = 1;
+    } else {
+        attr.period = period;
+    }
+    attr.symbolMode = desc->symbol_mode;
+    attr.dataFilter = desc->data_filter;
+    attr.evFilter = desc->ev_filter;
+    attr.minLatency = desc->min_latency;
+
+    pd = PmuOpen(desc->task_type, &attr);
+    if (pd == -1) {
+        printf("%s: %s\n", desc->name, Perror());
+    }
+
+    return pd;
+}
+
+static void pmu_close(int pd)
+{
+    PmuDisable(pd);
+    PmuClose(pd);
+}
+
+static int pmu_read(int pd, enum pmu_read_mode mode, struct pmu_counters *counters, struct PmuData **data)
+{
+    int len;
+
+    *data = NULL;
+    if (mode == PMU_READ_PAUSED) {
+        PmuDisable(pd);
+    }
+    len = PmuRead(pd, data);
+    if (mode == PMU_READ_PAUSED) {
+        PmuEnable(pd);
+    }
+
+    if (len < 0) {
+        printf("%s\n", Perror());
+        return 0;
+    }
+
+    if (mode == PMU_READ_CONTINUOUS) {
+        pmu_counters_delta(counters, *data, len);
+    }
+
+    return len;
+}
+
+/* Starts from the configured period, unless the session already adapted to the same one. */
+static void rate_reset(struct pmu_rate *rate, const struct pmu_instance_desc *desc)
+{
+    if (rate->period != 0 && rate->base == desc->period && desc->sample_budget != 0) {
+        return;
+    }
+    rate->base = desc->period;
+    rate->period = desc->period;
+    rate->reads = 0;
+}
+
+/* The period holding sample_budget records per read, given a read of len records that took
+ * cost_ns. A read over a quarter of run_period holds up the other collectors and counts as
+ * twice the budget at least.
+ */
+static unsigned rate_adapt(const struct pmu_instance_desc *desc, struct pmu_rate *rate, int len, uint64_t cost_ns)
+{
+    double ratio;
+    double period;
+
+    if (desc->sample_budget == 0 || desc->task_type != SPE_SAMPLING) {
+        return rate->period;
+    }
+    // Let a new period fill a few reads before judging it.
+    if (++rate->reads < RATE_SETTLE_READS) {
+        return rate->period;
+    }
+
+    ratio = (double)len / desc->sample_budget;
+    if (cost_ns * RATE_COST_SHARE > (uint64_t)desc->run_period * NSEC_PER_MSEC && ratio < RATE_HIGH * 2) {
+        ratio = RATE_HIGH * 2;
+    }
+    if (ratio > RATE_HIGH) {
+        period = rate->period * (ratio < RATE_MAX_STEP ? ratio : RATE_MAX_STEP);
+    } else if (ratio < RATE_LOW && rate->period > rate->base) {
+        period = rate->period * (ratio > 1.0 / RATE_MAX_STEP ? ratio : 1.0 / RATE_MAX_STEP);
+    } else {
+        return rate->period;
+    }
+
+    if (period < rate->base) {
+        period = rate->base;
+    }
+    if (period > RATE_PERIOD_MAX) {
+        period = RATE_PERIOD_MAX;
+    }
+    return (unsigned)period;
+}
+
+/* Moves an SPE session to another period. SPE opens no named events and has one buffer per
+ * cpu, so the old pd goes first. Returns the new pd, the pd of the old period if the new one
+ * failed, or -1.
+ */
+static int rate_reopen(const struct pmu_instance_desc *desc, struct pmu_rate *rate, int pd, unsigned period)
+{
+    unsigned periods[] = {period, rate->period};
+
+    pmu_close(pd);
+    rate->reads = 0;
+    for (int i = 0; i < 2; i++) {
+        pd = pmu_open(desc, periods[i], NULL, 0);
+        if (pd == -1) {
+            continue;
+        }
+        if (PmuEnable(pd) != 0) {
+            PmuClose(pd);
+            continue;
+        }
+        rate->period = periods[i];
+        return pd;
+    }
+
+    printf("%s reopen failed, stop reading\n", desc->name);
+    return -1;
+}
+
+/* Consumers rescale SPE counts by the period the records were taken with. */
+static void stamp_period(const struct pmu_instance_desc *desc, struct PmuData *data, int len, unsigned period)
+{
+    if (desc->task_type != SPE_SAMPLING) {
+        return;
+    }
+    for (int i = 0; i < len; i++) {
+        data[i].period = period;
+    }
+}
+
+static int load_events(struct pmu_instance *ins)
+{
+    const struct pmu_instance_desc *desc = &ins->desc;
+
+    if (desc->get_events == NULL) {
+        for (int i = 0; i < desc->evt_num; i++) {
+            ins->evts[i] = (char *)desc->evt_list[i];
+        }
+        ins->evt_list = ins->evts;
+        ins->evt_num = desc->evt_num;
+        return 0;
+    }
+
+    if (desc->get_events(desc, &ins->evt_list, &ins->evt_num) != 0) {
+        // Enable is retried by the framework, only report an unsupported system once.
+        printf("This system not support %s\n", desc->name);
+        ins->unsupported = true;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void unload_events(struct pmu_instance *ins)
+{
+    if (ins->desc.put_events != NULL) {
+        ins->desc.put_events(ins->evt_list);
+    }
+    ins->evt_list = NULL;
+    ins->evt_num = 0;
+}
+
+static void group_read_put(struct pmu_group_read *read)
+{
+    if (read == NULL || __atomic_sub_fetch(&read->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    PmuDataFree(read->data);
+    free(read);
+}
+
+static void member_data_free(void *data)
+{
+    struct pmu_member_data *member_data;
+
+    member_data = (struct pmu_member_data *)((char *)data - offsetof(struct pmu_member_data, data));
+    group_read_put(member_data->read);
+    free(member_data);
+}
+
+/* Opens the group with the events of its members in the group, replacing the old pd only
+ * if the new one could be opened.
+ */
+static int group_reopen(struct pmu_group *group)
+{
+    char **evt_list;
+    const struct pmu_instance_desc *desc = NULL;
+    int evt_max = 0;
+    int evt_num = 0;
+    int pd;
+
+    // Members with get_events may list more than PMU_EVT_MAX events.
+    for (int i = 0; i < instance_num; i++) {
+        if (instances[i].group == group && instances[i].in_group) {
+            evt_max += instances[i].evt_num;
+        }
+    }
+    evt_list = (char **)malloc(sizeof(char *) * (evt_max + 1));
+    if (evt_list == NULL) {
+        printf("malloc group evt_list failed\n");
+        return -1;
+    }
+
+    for (int i = 0; i < instance_num; i++) {
+        struct pmu_instance *ins = &instances[i];
+
+        if (ins->group != group || !ins->in_group) {
+            continue;
+        }
+        desc = &ins->desc;
+        for (int j = 0; j < ins->evt_num; j++) {
+            // Members counting the same event share it.
+            int k = 0;
+            while (k < evt_num && strcmp(evt_list[k], ins->evt_list[j]) != 0) {
+                k++;
+            }
+            if (k == evt_num) {
+                evt_list[evt_num++] = ins->evt_list[j];
+            }
+        }
+    }
+
+    if (desc == NULL) {
+        free(evt_list);
+        if (group->pd != -1) {
+            pmu_close(group->pd);
+            group->pd = -1;
+        }
+        group_read_put(group->read);
+        group->read = NULL;
+        pmu_counters_free(&group->counters);
+        return 0;
+    }
+
+    rate_reset(&group->rate, desc);
+    pd = pmu_open(desc, group->rate.period, evt_list, evt_num);
+    free(evt_list);
+    if (pd == -1) {
+        return -1;
+    }
+    if (PmuEnable(pd) != 0) {
+        PmuClose(pd);
+        return -1;
+    }
+
+    if (group->pd != -1) {
+        pmu_close(group->pd);
+    }
+    group->pd = pd;
+    group_read_put(group->read);
+    group->read = NULL;
+    pmu_counters_reset(&group->counters);
+
+    // The next member to run reads the new pd.
+    group->read_seq++;
+    for (int i = 0; i < instance_num; i++) {
+        if (instances[i].group == group) {
+            instances[i].read_seq = group->read_seq;
+            instances[i].last_read_ns = now_ns();
+        }
+    }
+
+    return 0;
+}
+
+/* Members share one PmuOpen, so they must agree on everything but the events. */
+static bool same_attr(const struct pmu_instance_desc *a, const struct pmu_instance_desc *b)
+{
+    return a->task_type == b->task_type && a->use_freq == b->use_freq && a->freq == b->freq &&
+        a->period == b->period && a->symbol_mode == b->symbol_mode && a->data_filter == b->data_filter &&
+        a->ev_filter == b->ev_filter && a->min_latency == b->min_latency && a->sample_budget == b->sample_budget;
+}
+
+static bool group_join(struct pmu_instance *ins)
+{
+    // A member configured to another period would miss the reads of the faster one.
+    if (ins->desc.run_period != ins->group->run_period || ins->desc.read_mode != ins->group->read_mode) {
+        return false;
+    }
+    for (int i = 0; i < instance_num; i++) {
+        if (instances[i].group == ins->group && instances[i].in_group && !same_attr(&instances[i].desc, &ins->desc)) {
+            return false;
+        }
+    }
+
+    ins->in_group = true;
+    if (group_reopen(ins->group) == 0) {
+        return true;
+    }
+
+    // Keep the other members collecting and try the events on their own.
+    ins->in_group = false;
+    return false;
+}
+
+static void group_leave(struct pmu_instance *ins)
+{
+    ins->in_group = false;
+    // On failure the old pd stays, the events of ins are then just not taken by anyone.
+    (void)group_reopen(ins->group);
+}
+
+static void group_read(struct pmu_group *group, const struct pmu_instance_desc *desc)
+{
+    struct pmu_group_read *read;
+    uint64_t start_ns = now_ns();
+    unsigned period;
+
+    read = (struct pmu_group_read *)malloc(sizeof(struct pmu_group_read));
+    if (read == NULL) {
+        printf("malloc group read failed\n");
+        return;
+    }
+
+    read->len = pmu_read(group->pd, group->read_mode, &group->counters, &read->data);
+    read->refs = 1;
+    read->read_ns = now_ns();
+    stamp_period(desc, read->data, read->len, group->rate.period);
+
+    group_read_put(group->read);
+    group->read = read;
+    group->read_seq++;
+
+    // The members still take this read, only the pd moves on.
+    period = rate_adapt(desc, &group->rate, read->len, read->read_ns - start_ns);
+    if (period != group->rate.period) {
+        group->pd = rate_reopen(desc, &group->rate, group->pd, period);
+    }
+}
+
+static bool member_has_event(const struct pmu_instance *ins, const char *evt)
+{
+    // SPE opens no named events, its members take every record.
+    if (ins->evt_num == 0) {
+        return true;
+    }
+    if (evt == NULL) {
+        return false;
+    }
+
+    for (int i = 0; i < ins->evt_num; i++) {
+        if (strcmp(ins->evt_list[i], evt) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Fills the next slot with a read ending at read_ns, or with what the instance derives
+ * from it.
+ */
+static void publish(struct pmu_instance *ins, struct PmuData *data, int len, data_free_fn free_data,
+    uint64_t read_ns)
+{
+    void *out = NULL;
+    data_free_fn free_out = NULL;
+    int out_len;
+
+    ins->interval_ns = read_ns - ins->last_read_ns;
+    ins->last_read_ns = read_ns;
+
+    if (ins->desc.transform == NULL) {
+        fill_buf_data(ins->buf, data, len, free_data);
+        return;
+    }
+
+    out_len = ins->desc.transform(&ins->desc, data, len, ins->interval_ns, &out, &free_out);
+    if (data != NULL && free_data != NULL) {
+        free_data(data);
+    }
+    fill_buf_data(ins->buf, out, out_len, free_out);
+}
+
+static void group_run(struct pmu_instance *ins)
+{
+    struct pmu_group *group = ins->group;
+    struct pmu_group_read *read;
+    struct pmu_member_data *member_data;
+    int len = 0;
+
+    // An SPE period change may have closed the pd and failed to open any, until a member
+    // joins or leaves.
+    if (group->pd == -1) {
+        return;
+    }
+    if (ins->read_seq == group->read_seq) {
+        group_read(group, &ins->desc);
+    }
+    ins->read_seq = group->read_seq;
+
+    read = group->read;
+    if (read == NULL) {
+        publish(ins, NULL, 0, NULL, now_ns());
+        return;
+    }
+
+    for (int i = 0; i < read->len; i++) {
+        if (member_has_event(ins, read->data[i].evt)) {
+            len++;
+        }
+    }
+    if (len == 0) {
+        publish(ins, NULL, 0, NULL, read->read_ns);
+        return;
+    }
+
+    member_data = (struct pmu_member_data *)malloc(sizeof(struct pmu_member_data) + sizeof(struct PmuData) * len);
+    if (member_data == NULL) {
+        printf("malloc %s data failed\n", ins->desc.name);
+        return;
+    }
+
+    // The copies share evt, stack and the other pointers with the group read.
+    member_data->read = read;
+    __atomic_add_fetch(&read->refs, 1, __ATOMIC_RELAXED);
+    len = 0;
+    for (int i = 0; i < read->len; i++) {
+        if (member_has_event(ins, read->data[i].evt)) {
+            member_data->data[len++] = read->data[i];
+        }
+    }
+
+    publish(ins, member_data->data, len, member_data_free, read->read_ns);
+}
+
+/* Opens the events of ins, through its group if it can. */
+static int open_events(struct pmu_instance *ins)
+{
+    if (load_events(ins) != 0) {
+        return -1;
+    }
+
+    if (ins->group != NULL && group_join(ins)) {
+        return 0;
+    }
+
+    rate_reset(&ins->rate, &ins->desc);
+    ins->pd = pmu_open(&ins->desc, ins->rate.period, ins->evt_list, ins->evt_num);
+    if (ins->pd == -1) {
+        goto err;
+    }
+    pmu_counters_reset(&ins->counters);
+    ins->last_read_ns = now_ns();
+    if (PmuEnable(ins->pd) != 0) {
+        PmuClose(ins->pd);
+        ins->pd = -1;
+        goto err;
+    }
+
+    return 0;
+
+err:
+    unload_events(ins);
+    return -1;
+}
+
+static void close_events(struct pmu_instance *ins)
+{
+    if (ins->pd != -1) {
+        pmu_close(ins->pd);
+        ins->pd = -1;
+    } else if (ins->in_group) {
+        group_leave(ins);
+    }
+
+    unload_events(ins);
+}
+
+bool pmu_engine_enable(int index)
+{
+    struct pmu_instance *ins = &instances[index];
+
+    if (ins->enabled) {
+        return true;
+    }
+    if (ins->unsupported) {
+        return false;
+    }
+
+    ins->buf = init_buf(ins->desc.buf_size, ins->desc.name);
+    if (!ins->buf) {
+        return false;
+    }
+
+    if (open_events(ins) != 0) {
+        free_buf(ins->buf);
+        ins->buf = NULL;
+        return false;
+    }
+
+    ins->enabled = true;
+    ins->last_run_ms = 0;
+    return true;
+}
+
+void pmu_engine_disable(int index)
+{
+    struct pmu_instance *ins = &instances[index];
+
+    if (!ins->enabled) {
+        return;
+    }
+    ins->enabled = false;
+
+    free_buf(ins->buf);
+    ins->buf = NULL;
+
+    close_events(ins);
+    pmu_counters_free(&ins->counters);
+}
+
+static bool desc_changed(const struct pmu_instance *ins, const struct pmu_instance_desc *desc)
+{
+    const struct pmu_instance_desc *cur = &ins->desc;
+
+    if (cur->evt_num != desc->evt_num) {
+        return true;
+    }
+    for (int i = 0; i < cur->evt_num; i++) {
+        if (strcmp(cur->evt_list[i], desc->evt_list[i]) != 0) {
+            return true;
+        }
+    }
+
+    // The period decides whether a counting instance can stay in its group.
+    return cur->use_freq != desc->use_freq || cur->freq != desc->freq || cur->period != desc->period ||
+        cur->symbol_mode != desc->symbol_mode || cur->data_filter != desc->data_filter ||
+        cur->ev_filter != desc->ev_filter || cur->min_latency != desc->min_latency ||
+        cur->sample_budget != desc->sample_budget ||
+        cur->read_mode != desc->read_mode || (ins->group != NULL && cur->run_period != desc->run_period);
+}
+
+/* Applies a reloaded descriptor, reopening the events only if the pd depends on a change.
+ * The ring and its history are kept.
+ */
+static void apply_desc(struct pmu_instance *ins, const struct pmu_instance_desc *desc)
+{
+    char old_names[PMU_EVT_MAX][PMU_EVT_NAME_LEN];
+    struct pmu_instance_desc old;
+
+    if (!ins->enabled || !desc_changed(ins, desc)) {
+        set_desc(ins, desc);
+        return;
+    }
+
+    old = ins->desc;
+    (void)memcpy_s(old_names, sizeof(old_names), ins->evt_names, sizeof(ins->evt_names));
+    for (int i = 0; i < old.evt_num; i++) {
+        old.evt_list[i] = old_names[i];
+    }
+
+    close_events(ins);
+    set_desc(ins, desc);
+    if (open_events(ins) == 0) {
+        printf("%s reopened with the new config\n", ins->desc.name);
+        return;
+    }
+
+    printf("%s cannot open with the new config, keep the old one\n", ins->desc.name);
+    set_desc(ins, &old);
+    if (open_events(ins) != 0) {
+        printf("%s reopen failed\n", ins->desc.name);
+    }
+}
+
+static void pmu_engine_reload(void)
+{
+    pmu_config_load(base_descs, conf_descs, instance_num);
+    for (int i = 0; i < instance_num; i++) {
+        apply_desc(&instances[i], &conf_descs[i]);
+    }
+}
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* The framework calls run every tick_period, skip the ticks inside a longer run_period. */
+static bool run_due(struct pmu_instance *ins)
+{
+    int64_t now;
+
+    if (ins->desc.run_period <= ins->tick_period) {
+        return true;
+    }
+
+    now = now_ms();
+    if (ins->last_run_ms != 0 && now - ins->last_run_ms + ins->tick_period / 2 < ins->desc.run_period) {
+        return false;
+    }
+    ins->last_run_ms = now;
+
+    return true;
+}
+
+void pmu_engine_run(int index)
+{
+    struct pmu_instance *ins = &instances[index];
+    struct PmuData *data;
+    uint64_t start_ns;
+    uint64_t read_ns;
+    unsigned period;
+    int len;
+
+    if (pmu_config_reload_pending()) {
+        pmu_engine_reload();
+    }
+    // No transform holds cached symbols between reads.
+    pmu_symbol_trim();
+
+    if (!ins->buf) {
+        printf("%s buf has not malloc\n", ins->desc.name);
+        return;
+    }
+
+    // Reopening with the new config and with the old one may both have failed.
+    if (ins->pd == -1 && !ins->in_group) {
+        return;
+    }
+
+    if (!run_due(ins)) {
+        return;
+    }
+
+    if (ins->pd == -1) {
+        group_run(ins);
+        return;
+    }
+
+    start_ns = now_ns();
+    len = pmu_read(ins->pd, ins->desc.read_mode, &ins->counters, &data);
+    read_ns = now_ns();
+    stamp_period(&ins->desc, data, len, ins->rate.period);
+    publish(ins, data, len, pmu_data_free, read_ns);
+
+    period = rate_adapt(&ins->desc, &ins->rate, len, read_ns - start_ns);
+    if (period != ins->rate.period) {
+        ins->pd = rate_reopen(&ins->desc, &ins->rate, ins->pd, period);
+    }
+}
+
+const struct PmuSlotRef *pmu_engine_acquire_latest(const char *name, uint64_t *interval_ns)
+{
+    for (int i = 0; i < instance_num; i++) {
+        struct pmu_instance *ins = &instances[i];
+
+        if (strcmp(ins->desc.name, name) != 0 || !ins->enabled || ins->desc.transform != NULL) {
+            continue;
+        }
+        *interval_ns = ins->interval_ns;
+        return PmuRingAcquireLatest(ins->buf);
+    }
+
+    return NULL;
+}
+
+const struct DataRingBuf *pmu_engine_get_ring_buf(int index)
+{
+    return (const struct DataRingBuf *)instances[index].buf;
+}
+
+const char *pmu_engine_get_name(int index)
+{
+    return instances[index].desc.name;
+}
+
+const char *pmu_engine_get_description(int index)
+{
+    return instances[index].desc.description;
+}
+
+int pmu_engine_get_period(int index)
+{
+    return instances[index].desc.run_period;
+}
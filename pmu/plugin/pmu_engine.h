@@ -0,0 +1,101 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PMU_ENGINE_H__
+#define __PMU_ENGINE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pmu.h"
+#include "plugin_comm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PMU_INSTANCE_MAX   12
+#define PMU_EVT_MAX        16
+
+struct DataRingBuf;
+struct PmuSlotRef;
+
+enum pmu_read_mode {
+    /* PmuDisable, PmuRead, PmuEnable: each slot holds one period. */
+    PMU_READ_PAUSED,
+    /* PmuRead only, SPE stops and restarts the collection inside PmuRead. */
+    PMU_READ_DIRECT,
+    /* COUNTING: PmuRead only, the counters keep running and each slot holds the
+     * difference of the totals to the previous read, so no event is lost between reads.
+     */
+    PMU_READ_CONTINUOUS,
+};
+
+/* Everything that tells one pmu instance from another. */
+struct pmu_instance_desc {
+    const char *name;
+    const char *description;
+    enum PmuTaskType task_type;
+    const char *evt_list[PMU_EVT_MAX];
+    int evt_num;
+    /* Expands evt_list to the events only known at runtime, such as those of the uncore
+     * units. Returns 0 on success, on failure the instance stays unsupported.
+     */
+    int (*get_events)(const struct pmu_instance_desc *desc, char ***evt_list, int *evt_num);
+    void (*put_events)(char **evt_list);
+    /* Sampling rate: freq if use_freq is set, period otherwise. */
+    unsigned freq;
+    unsigned period;
+    bool use_freq;
+    enum SymbolMode symbol_mode;
+    /* SPE_SAMPLING only. */
+    enum SpeFilter data_filter;
+    enum SpeEventFilter ev_filter;
+    unsigned long min_latency;
+    /* SPE records wanted per read, 0 to keep period fixed. The period in use is written to
+     * PmuData.period of each record.
+     */
+    unsigned sample_budget;
+    int buf_size;
+    int run_period;
+    enum pmu_read_mode read_mode;
+    /* Instances with the same non-zero group, run_period and read_mode share one PmuOpen, read
+     * once per period for all members. A member whose sampling attributes were configured
+     * apart from the others opens its own pd.
+     */
+    int group;
+    /* Publishes what is derived from a read instead of the PmuData. Returns the entry count
+     * of *out, which is released with *free_data.
+     */
+    int (*transform)(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+        uint64_t interval_ns, void **out, data_free_fn *free_data);
+    /* Entries a transform publishes at most, 0 for its default. */
+    int out_limit;
+};
+
+/* Registers the descriptor table, which must outlive the plugin. */
+int pmu_engine_init(const struct pmu_instance_desc *descs, int num);
+const char *pmu_engine_get_name(int ins);
+const char *pmu_engine_get_description(int ins);
+int pmu_engine_get_period(int ins);
+bool pmu_engine_enable(int ins);
+void pmu_engine_disable(int ins);
+const struct DataRingBuf *pmu_engine_get_ring_buf(int ins);
+void pmu_engine_run(int ins);
+/* Takes the newest PmuData published by the enabled instance name and the interval it
+ * covers, or NULL. Give it back with PmuRingRelease.
+ */
+const struct PmuSlotRef *pmu_engine_acquire_latest(const char *name, uint64_t *interval_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,360 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <securec.h>
+#include "pmu.h"
+#include "pmu_plugin.h"
+#include "pmu_engine.h"
+#include "pmu_heatmap.h"
+
+#define NODE_PATH           "/sys/devices/system/node"
+#define BLOCK_SIZE_PATH     "/sys/devices/system/memory/block_size_bytes"
+#define MAX_PATH_LEN        256
+/* 4 way sets: 8192 pages tracked per interval. */
+#define HEATMAP_WAYS        4
+#define HEATMAP_SETS        2048
+#define LAT_FIRST_SHIFT     6
+#define NSEC_PER_USEC       1000
+
+struct page_entry {
+    uint64_t vpage;
+    uint64_t ppage;
+    int pid;
+    int node;
+    uint32_t samples;
+    uint64_t latency_sum;
+};
+
+/* Bounded sketch of the pages of one interval. A new page takes a free way of its set, or
+ * wears down the coldest one, so pages hot for the interval stay while one-offs pass through.
+ */
+static struct page_entry (*page_sets)[HEATMAP_WAYS] = NULL;
+static struct page_entry **hot_pages = NULL;
+static int page_shift = 0;
+/* Memory block index to node, built on first use. */
+static signed char *block_nodes = NULL;
+static uint64_t block_num = 0;
+static uint64_t block_size = 0;
+static bool nodes_loaded = false;
+
+static int get_page_shift(void)
+{
+    long size = sysconf(_SC_PAGESIZE);
+    int shift = 0;
+
+    while (size > 1) {
+        size >>= 1;
+        shift++;
+    }
+    return shift;
+}
+
+static int read_block_size(void)
+{
+    char buf[32] = {0};
+    FILE *file;
+
+    file = fopen(BLOCK_SIZE_PATH, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    if (fgets(buf, sizeof(buf), file) == NULL) {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    block_size = strtoull(buf, NULL, 16);
+
+    return block_size == 0 ? -1 : 0;
+}
+
+static int set_block_node(uint64_t block, int node)
+{
+    if (block >= block_num) {
+        uint64_t num = block_num == 0 ? 1024 : block_num;
+        signed char *nodes;
+
+        while (num <= block) {
+            num *= 2;
+        }
+        nodes = (signed char *)realloc(block_nodes, num);
+        if (nodes == NULL) {
+            return -1;
+        }
+        (void)memset_s(nodes + block_num, num - block_num, PMU_HEATMAP_UNKNOWN_NODE, num - block_num);
+        block_nodes = nodes;
+        block_num = num;
+    }
+    block_nodes[block] = (signed char)node;
+
+    return 0;
+}
+
+/* Each nodeN directory links the memoryM blocks it holds. */
+static void load_block_nodes(void)
+{
+    char path[MAX_PATH_LEN];
+    struct dirent *node_ent;
+    DIR *node_dir;
+
+    nodes_loaded = true;
+    if (read_block_size() != 0) {
+        return;
+    }
+    node_dir = opendir(NODE_PATH);
+    if (node_dir == NULL) {
+        return;
+    }
+
+    while ((node_ent = readdir(node_dir)) != NULL) {
+        struct dirent *mem_ent;
+        DIR *mem_dir;
+        char *end;
+        long node;
+
+        if (strncmp(node_ent->d_name, "node", strlen("node")) != 0) {
+            continue;
+        }
+        node = strtol(node_ent->d_name + strlen("node"), &end, 10);
+        if (*end != '\0' || node < 0 || node >= PMU_HEATMAP_NODE_MAX) {
+            continue;
+        }
+        (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s/%s", NODE_PATH, node_ent->d_name);
+        mem_dir = opendir(path);
+        if (mem_dir == NULL) {
+            continue;
+        }
+        while ((mem_ent = readdir(mem_dir)) != NULL) {
+            unsigned long long block;
+
+            if (strncmp(mem_ent->d_name, "memory", strlen("memory")) != 0) {
+                continue;
+            }
+            block = strtoull(mem_ent->d_name + strlen("memory"), &end, 10);
+            if (*end != '\0' || end == mem_ent->d_name + strlen("memory")) {
+                continue;
+            }
+            (void)set_block_node(block, (int)node);
+        }
+        closedir(mem_dir);
+    }
+    closedir(node_dir);
+}
+
+static int pa_node(uint64_t pa)
+{
+    uint64_t block;
+
+    if (pa == 0 || block_size == 0) {
+        return PMU_HEATMAP_UNKNOWN_NODE;
+    }
+    block = pa / block_size;
+    return block < block_num ? block_nodes[block] : PMU_HEATMAP_UNKNOWN_NODE;
+}
+
+static int latency_bucket(unsigned lat)
+{
+    int bucket;
+
+    if (lat < (1U << LAT_FIRST_SHIFT)) {
+        return 0;
+    }
+    bucket = 31 - __builtin_clz(lat) - LAT_FIRST_SHIFT + 1;
+    return bucket < PMU_HEATMAP_LAT_BUCKETS ? bucket : PMU_HEATMAP_LAT_BUCKETS - 1;
+}
+
+static uint32_t page_hash(int pid, uint64_t vpage)
+{
+    uint64_t h = (vpage ^ ((uint64_t)(uint32_t)pid << 40)) * 0x9e3779b97f4a7c15ULL;
+
+    return (uint32_t)(h >> 32);
+}
+
+/* Returns the samples that fell out of the sketch, this one or those of the page it replaced. */
+static uint32_t add_page(int pid, uint64_t vpage, uint64_t ppage, int node, unsigned lat)
+{
+    struct page_entry *set = page_sets[page_hash(pid, vpage) & (HEATMAP_SETS - 1)];
+    struct page_entry *coldest = NULL;
+    uint32_t dropped;
+
+    for (int i = 0; i < HEATMAP_WAYS; i++) {
+        struct page_entry *e = &set[i];
+
+        if (e->samples != 0 && e->pid == pid && e->vpage == vpage) {
+            e->samples++;
+            e->latency_sum += lat;
+            // Pages migrate, keep where the latest access went.
+            if (ppage != 0) {
+                e->ppage = ppage;
+                e->node = node;
+            }
+            return 0;
+        }
+        if (coldest == NULL || e->samples < coldest->samples) {
+            coldest = e;
+        }
+    }
+
+    if (coldest->samples > 1) {
+        coldest->latency_sum -= coldest->latency_sum / coldest->samples;
+        coldest->samples--;
+        return 1;
+    }
+
+    dropped = coldest->samples;
+    coldest->vpage = vpage;
+    coldest->ppage = ppage;
+    coldest->pid = pid;
+    coldest->node = node;
+    coldest->samples = 1;
+    coldest->latency_sum = lat;
+    return dropped;
+}
+
+static void add_latency(struct PmuNodeLatency *rows, int node, unsigned lat)
+{
+    struct PmuNodeLatency *row = &rows[node == PMU_HEATMAP_UNKNOWN_NODE ? PMU_HEATMAP_NODE_MAX : node];
+
+    row->samples++;
+    row->latencySum += lat;
+    row->hist[latency_bucket(lat)]++;
+}
+
+static int hotter(const void *a, const void *b)
+{
+    const struct page_entry *x = *(const struct page_entry *const *)a;
+    const struct page_entry *y = *(const struct page_entry *const *)b;
+
+    if (x->samples != y->samples) {
+        return x->samples < y->samples ? 1 : -1;
+    }
+    return x->latency_sum < y->latency_sum ? 1 : (x->latency_sum > y->latency_sum ? -1 : 0);
+}
+
+/* Keeps the node rows with samples, the unknown row last. */
+static void compact_nodes(struct PmuSpeHeatmap *map, const struct PmuNodeLatency *rows)
+{
+    map->nodeNum = 0;
+    for (int i = 0; i <= PMU_HEATMAP_NODE_MAX; i++) {
+        if (rows[i].samples == 0) {
+            continue;
+        }
+        map->nodes[map->nodeNum] = rows[i];
+        map->nodes[map->nodeNum].node = i == PMU_HEATMAP_NODE_MAX ? PMU_HEATMAP_UNKNOWN_NODE : i;
+        map->nodeNum++;
+    }
+}
+
+static int fill_pages(struct PmuSpeHeatmap *map, int limit)
+{
+    int num = 0;
+
+    for (int s = 0; s < HEATMAP_SETS; s++) {
+        for (int w = 0; w < HEATMAP_WAYS; w++) {
+            if (page_sets[s][w].samples != 0) {
+                hot_pages[num++] = &page_sets[s][w];
+            }
+        }
+    }
+    qsort(hot_pages, num, sizeof(struct page_entry *), hotter);
+
+    map->pageNum = num < limit ? num : limit;
+    for (int i = 0; i < map->pageNum; i++) {
+        const struct page_entry *e = hot_pages[i];
+        struct PmuHeatmapPage *page = &map->pages[i];
+
+        page->pid = e->pid;
+        page->node = e->node;
+        page->vpage = e->vpage;
+        page->ppage = e->ppage;
+        page->samples = e->samples;
+        page->avgLatency = (uint32_t)(e->latency_sum / e->samples);
+    }
+
+    return map->pageNum;
+}
+
+static int reserve_sets(void)
+{
+    if (page_sets != NULL) {
+        (void)memset_s(page_sets, sizeof(struct page_entry) * HEATMAP_WAYS * HEATMAP_SETS, 0,
+            sizeof(struct page_entry) * HEATMAP_WAYS * HEATMAP_SETS);
+        return 0;
+    }
+
+    page_sets = calloc(HEATMAP_SETS, sizeof(struct page_entry) * HEATMAP_WAYS);
+    hot_pages = (struct page_entry **)malloc(sizeof(struct page_entry *) * HEATMAP_WAYS * HEATMAP_SETS);
+    if (page_sets == NULL || hot_pages == NULL) {
+        free(page_sets);
+        free(hot_pages);
+        page_sets = NULL;
+        hot_pages = NULL;
+        return -1;
+    }
+    page_shift = get_page_shift();
+
+    return 0;
+}
+
+int pmu_heatmap_aggregate(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data)
+{
+    struct PmuNodeLatency rows[PMU_HEATMAP_NODE_MAX + 1];
+    int limit = desc->out_limit > 0 ? desc->out_limit : PMU_HEATMAP_DEFAULT_PAGES;
+    struct PmuSpeHeatmap *map;
+
+    *out = NULL;
+    *free_data = NULL;
+
+    if (!nodes_loaded) {
+        load_block_nodes();
+    }
+    if (reserve_sets() != 0) {
+        printf("malloc heatmap pages failed\n");
+        return 0;
+    }
+    map = (struct PmuSpeHeatmap *)malloc(sizeof(struct PmuSpeHeatmap) + sizeof(struct PmuHeatmapPage) * limit);
+    if (map == NULL) {
+        printf("malloc heatmap failed\n");
+        return 0;
+    }
+    (void)memset_s(map, sizeof(struct PmuSpeHeatmap), 0, sizeof(struct PmuSpeHeatmap));
+    (void)memset_s(rows, sizeof(rows), 0, sizeof(rows));
+    map->intervalUs = (uint32_t)(interval_ns / NSEC_PER_USEC);
+    map->pageShift = page_shift;
+    // Every record of a read carries the period it was sampled with.
+    map->period = len > 0 ? (uint32_t)data[0].period : desc->period;
+    map->pages = (struct PmuHeatmapPage *)(map + 1);
+
+    for (int i = 0; i < len; i++) {
+        const struct PmuDataExt *ext = data[i].ext;
+        int node;
+
+        if (ext == NULL || ext->va == 0) {
+            continue;
+        }
+        node = pa_node(ext->pa);
+        map->samples++;
+        add_latency(rows, node, ext->lat);
+        map->untracked += add_page(data[i].pid, ext->va >> page_shift, ext->pa >> page_shift, node, ext->lat);
+    }
+    compact_nodes(map, rows);
+    fill_pages(map, limit);
+
+    *out = map;
+    *free_data = free;
+    return 1;
+}
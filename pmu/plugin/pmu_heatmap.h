@@ -9,24 +9,26 @@
  * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
  * See the Mulan PSL v2 for more details.
  ******************************************************************************/
-#ifndef __PLUGIN_SAMPLING_H__
-#define __PLUGIN_SAMPLING_H__
+#ifndef __PMU_HEATMAP_H__
+#define __PMU_HEATMAP_H__
+
+#include <stdint.h>
+#include "plugin_comm.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-const char *sampling_get_version();
-const char *sampling_get_name();
-const char *sampling_get_description();
-const char *sampling_get_dep();
-int sampling_get_priority();
-int sampling_get_type();
-int sampling_get_period();
-bool sampling_enable();
-void sampling_disable();
-const struct DataRingBuf *sampling_get_ring_buf();
-void sampling_run(const struct Param *param);
+#define PMU_HEATMAP_DEFAULT_PAGES 256
+
+struct PmuData;
+struct pmu_instance_desc;
+
+/* pmu_instance_desc transform: folds the SPE records of one interval into one PmuSpeHeatmap
+ * with the out_limit hottest pages and the latency histogram of each memory node.
+ */
+int pmu_heatmap_aggregate(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data);
 
 #ifdef __cplusplus
 }
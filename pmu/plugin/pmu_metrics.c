@@ -0,0 +1,222 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <securec.h>
+#include "pmu.h"
+#include "pmu_plugin.h"
+#include "pmu_engine.h"
+#include "pmu_metrics.h"
+
+#define NSEC_PER_SEC   1000000000.0
+#define NSEC_PER_USEC  1000
+
+/* Columns derived from the counts, after the event columns. */
+enum metrics_column {
+    COLUMN_IPC = METRICS_EVENT_MAX,
+    COLUMN_CACHE_MPKI,
+    COLUMN_BRANCH_MPKI,
+    COLUMN_MAX,
+};
+
+/* Per cpu columns, the last row is the system-wide one. */
+static double *columns = NULL;
+static int column_rows = 0;
+
+static int reserve_columns(int rows)
+{
+    double *buf;
+
+    if (rows <= column_rows) {
+        return 0;
+    }
+
+    buf = (double *)realloc(columns, sizeof(double) * COLUMN_MAX * rows);
+    if (buf == NULL) {
+        return -1;
+    }
+    columns = buf;
+    column_rows = rows;
+
+    return 0;
+}
+
+static int event_index(const struct pmu_instance_desc *desc, const char *evt)
+{
+    if (evt == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < desc->evt_num && i < METRICS_EVENT_MAX; i++) {
+        if (strcmp(desc->evt_list[i], evt) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void sum_counts(const struct pmu_instance_desc *desc, const struct PmuData *data, int len, int cpu_num)
+{
+    const char *last_evt = NULL;
+    int event = -1;
+    int rows = cpu_num + 1;
+
+    (void)memset_s(columns, sizeof(double) * METRICS_EVENT_MAX * rows, 0, sizeof(double) * METRICS_EVENT_MAX * rows);
+
+    for (int i = 0; i < len; i++) {
+        // PmuRead returns the cpus of one event next to each other.
+        if (data[i].evt != last_evt) {
+            last_evt = data[i].evt;
+            event = event_index(desc, last_evt);
+        }
+        if (event < 0) {
+            continue;
+        }
+        if (data[i].cpu >= 0) {
+            columns[event * rows + data[i].cpu] += (double)data[i].count;
+        }
+        columns[event * rows + cpu_num] += (double)data[i].count;
+    }
+}
+
+/* max(x, 1) for the counts, which are whole and not negative, without a branch. */
+static inline double at_least_one(double x)
+{
+    return x + (double)(x == 0.0);
+}
+
+/* Column to column without branches, so the loop vectorizes. Ratios of empty rows are 0. */
+static void derive_ratios(int rows, const double *restrict cycles, const double *restrict instructions,
+    const double *restrict cache_misses, const double *restrict branch_misses, double *restrict ipc,
+    double *restrict cache_mpki, double *restrict branch_mpki)
+{
+    for (int i = 0; i < rows; i++) {
+        double kilo_instructions = at_least_one(instructions[i]) / 1000.0;
+
+        ipc[i] = instructions[i] / at_least_one(cycles[i]);
+        cache_mpki[i] = cache_misses[i] / kilo_instructions;
+        branch_mpki[i] = branch_misses[i] / kilo_instructions;
+    }
+}
+
+static void derive_rows(struct PmuCpuMetrics *metrics, int rows, uint64_t interval_ns)
+{
+    const double *cycles = &columns[METRICS_CYCLES * rows];
+    const double *instructions = &columns[METRICS_INSTRUCTIONS * rows];
+    const double *cache_misses = &columns[METRICS_CACHE_MISSES * rows];
+    const double *branch_misses = &columns[METRICS_BRANCH_MISSES * rows];
+    double *ipc = &columns[COLUMN_IPC * rows];
+    double *cache_mpki = &columns[COLUMN_CACHE_MPKI * rows];
+    double *branch_mpki = &columns[COLUMN_BRANCH_MPKI * rows];
+    double per_sec = interval_ns > 0 ? NSEC_PER_SEC / (double)interval_ns : 0;
+    uint32_t interval_us = (uint32_t)(interval_ns / NSEC_PER_USEC);
+
+    derive_ratios(rows, cycles, instructions, cache_misses, branch_misses, ipc, cache_mpki, branch_mpki);
+
+    for (int i = 0; i < rows; i++) {
+        metrics[i].cpu = i;
+        metrics[i].intervalUs = interval_us;
+        metrics[i].cycles = (uint64_t)cycles[i];
+        metrics[i].instructions = (uint64_t)instructions[i];
+        metrics[i].cacheMisses = (uint64_t)cache_misses[i];
+        metrics[i].branchMisses = (uint64_t)branch_misses[i];
+        metrics[i].ipc = ipc[i];
+        metrics[i].cacheMpki = cache_mpki[i];
+        metrics[i].branchMpki = branch_mpki[i];
+        metrics[i].cyclesRate = cycles[i] * per_sec;
+        metrics[i].instructionsRate = instructions[i] * per_sec;
+        metrics[i].cacheMissesRate = cache_misses[i] * per_sec;
+        metrics[i].branchMissesRate = branch_misses[i] * per_sec;
+        metrics[i].uncoreRxOuterRate = 0;
+        metrics[i].uncoreRxScclRate = 0;
+        metrics[i].uncoreRxOpsRate = 0;
+    }
+    metrics[rows - 1].cpu = PMU_METRICS_ALL_CPU;
+}
+
+/* Rates of the latest uncore read, if that instance is enabled. */
+static void derive_uncore(struct PmuCpuMetrics *metrics)
+{
+    const struct PmuSlotRef *ref;
+    const struct PmuData *data;
+    uint64_t interval_ns;
+    double rx_outer = 0;
+    double rx_sccl = 0;
+    double rx_ops = 0;
+    double per_sec;
+
+    ref = pmu_engine_acquire_latest(PMU_UNCORE, &interval_ns);
+    if (ref == NULL) {
+        return;
+    }
+
+    data = (const struct PmuData *)ref->data;
+    for (int i = 0; i < ref->len; i++) {
+        if (data[i].evt == NULL) {
+            continue;
+        }
+        if (strstr(data[i].evt, "/rx_outer/") != NULL) {
+            rx_outer += (double)data[i].count;
+        } else if (strstr(data[i].evt, "/rx_sccl/") != NULL) {
+            rx_sccl += (double)data[i].count;
+        } else if (strstr(data[i].evt, "/rx_ops_num/") != NULL) {
+            rx_ops += (double)data[i].count;
+        }
+    }
+    PmuRingRelease(ref);
+    if (interval_ns == 0) {
+        return;
+    }
+
+    per_sec = NSEC_PER_SEC / (double)interval_ns;
+    metrics->uncoreRxOuterRate = rx_outer * per_sec;
+    metrics->uncoreRxScclRate = rx_sccl * per_sec;
+    metrics->uncoreRxOpsRate = rx_ops * per_sec;
+}
+
+int pmu_metrics_derive(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data)
+{
+    struct PmuCpuMetrics *metrics;
+    int cpu_num = 0;
+    int rows;
+
+    *out = NULL;
+    *free_data = NULL;
+
+    for (int i = 0; i < len; i++) {
+        if (data[i].cpu + 1 > cpu_num) {
+            cpu_num = data[i].cpu + 1;
+        }
+    }
+    rows = cpu_num + 1;
+
+    if (reserve_columns(rows) != 0) {
+        printf("malloc metrics columns failed\n");
+        return 0;
+    }
+    metrics = (struct PmuCpuMetrics *)malloc(sizeof(struct PmuCpuMetrics) * rows);
+    if (metrics == NULL) {
+        printf("malloc metrics failed\n");
+        return 0;
+    }
+
+    sum_counts(desc, data, len, cpu_num);
+    derive_rows(metrics, rows, interval_ns);
+    derive_uncore(&metrics[rows - 1]);
+
+    *out = metrics;
+    *free_data = free;
+    return rows;
+}
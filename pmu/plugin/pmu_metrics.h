@@ -0,0 +1,44 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PMU_METRICS_H__
+#define __PMU_METRICS_H__
+
+#include <stdint.h>
+#include "plugin_comm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct PmuData;
+struct pmu_instance_desc;
+
+/* The events of pmu_derived_metrics by position, so the config file can replace them with
+ * the names a cpu uses, e.g. "cycles,inst_retired,l2d_cache_refill,br_mis_pred_retired".
+ */
+enum metrics_event {
+    METRICS_CYCLES,
+    METRICS_INSTRUCTIONS,
+    METRICS_CACHE_MISSES,
+    METRICS_BRANCH_MISSES,
+    METRICS_EVENT_MAX,
+};
+
+/* pmu_instance_desc transform: turns the counts of one interval into PmuCpuMetrics. */
+int pmu_metrics_derive(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
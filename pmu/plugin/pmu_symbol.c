@@ -0,0 +1,802 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <securec.h>
+#include "pmu_plugin.h"
+#include "pmu_symbol.h"
+
+#define SYMBOL_CACHE_SIZE   4096
+#define PROC_BUCKETS        256
+#define PROC_CACHE_MAX      1024
+#define ELF_CACHE_MAX       512
+#define PROC_IDLE_MS        10000
+#define TRIM_INTERVAL_MS    1000
+#define MAPS_LINE_LEN       (PATH_MAX + 128)
+#define BUILD_ID_MAX        20
+#define KALLSYMS_PATH       "/proc/kallsyms"
+#define KALLSYMS_LINE_LEN   512
+#define KERNEL_MODULE       "[kernel.kallsyms]"
+
+struct sym_entry {
+    uint64_t addr;
+    uint64_t size;
+    const char *name;
+};
+
+/* The function symbols of one binary, sorted by address. ELF names point into the mapping. */
+struct elf_table {
+    unsigned char build_id[BUILD_ID_MAX];
+    int build_id_len;
+    char *path;
+    void *map;
+    size_t map_len;
+    const Elf64_Phdr *phdrs;
+    int phdr_num;
+    struct sym_entry *syms;
+    int sym_num;
+    /* kallsyms only, the names are copied. */
+    char *names;
+    struct elf_table *next;
+};
+
+/* A file seen in some maps, by device and inode. table is NULL if it could not be read. */
+struct elf_file {
+    unsigned long dev;
+    unsigned long ino;
+    struct elf_table *table;
+    struct elf_file *next;
+};
+
+struct proc_map {
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    struct elf_table *elf;
+};
+
+/* The executable mappings of a process, sorted by address. */
+struct proc_maps {
+    int pid;
+    uint64_t used_ms;
+    uint64_t loaded_ms;
+    struct proc_map *maps;
+    int num;
+    struct proc_maps *next;
+};
+
+struct symbol_slot {
+    const struct elf_table *elf;
+    uint64_t offset;
+    const struct sym_entry *sym;
+};
+
+static pthread_mutex_t symbol_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct symbol_slot symbol_cache[SYMBOL_CACHE_SIZE];
+static struct proc_maps *procs[PROC_BUCKETS];
+static int proc_num = 0;
+static struct elf_file *files = NULL;
+static struct elf_table *tables = NULL;
+static int table_num = 0;
+static struct elf_table *kernel = NULL;
+static bool kernel_loaded = false;
+static uint64_t last_trim_ms = 0;
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static int sym_cmp(const void *a, const void *b)
+{
+    const struct sym_entry *x = (const struct sym_entry *)a;
+    const struct sym_entry *y = (const struct sym_entry *)b;
+
+    if (x->addr != y->addr) {
+        return x->addr < y->addr ? -1 : 1;
+    }
+    // Of aliases, keep the one with a size first.
+    return (x->size == 0) - (y->size == 0);
+}
+
+/* Sorts the symbols and drops the aliases of an address. */
+static void sort_syms(struct elf_table *table)
+{
+    int n = 0;
+
+    qsort(table->syms, table->sym_num, sizeof(struct sym_entry), sym_cmp);
+    for (int i = 0; i < table->sym_num; i++) {
+        if (n > 0 && table->syms[n - 1].addr == table->syms[i].addr) {
+            continue;
+        }
+        table->syms[n++] = table->syms[i];
+    }
+    table->sym_num = n;
+}
+
+static const struct sym_entry *find_sym(const struct elf_table *table, uint64_t addr)
+{
+    const struct sym_entry *sym;
+    int lo = 0;
+    int hi = table->sym_num;
+
+    // The last symbol starting at or before addr.
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+
+        if (table->syms[mid].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return NULL;
+    }
+
+    sym = &table->syms[lo - 1];
+    if (sym->size != 0 && addr - sym->addr >= sym->size) {
+        return NULL;
+    }
+    return sym;
+}
+
+static void free_table(struct elf_table *table)
+{
+    if (table->map != NULL) {
+        munmap(table->map, table->map_len);
+    }
+    free(table->syms);
+    free(table->names);
+    free(table->path);
+    free(table);
+}
+
+static bool in_file(const struct elf_table *table, uint64_t offset, uint64_t size)
+{
+    return offset <= table->map_len && size <= table->map_len - offset;
+}
+
+static void read_build_id(struct elf_table *table, const Elf64_Shdr *shdrs, int shnum)
+{
+    for (int i = 0; i < shnum; i++) {
+        const char *note = (const char *)table->map + shdrs[i].sh_offset;
+        uint64_t left = shdrs[i].sh_size;
+
+        if (shdrs[i].sh_type != SHT_NOTE || !in_file(table, shdrs[i].sh_offset, left)) {
+            continue;
+        }
+        while (left >= sizeof(Elf64_Nhdr)) {
+            const Elf64_Nhdr *nhdr = (const Elf64_Nhdr *)note;
+            uint64_t name_len = (nhdr->n_namesz + 3) & ~3ULL;
+            uint64_t desc_len = (nhdr->n_descsz + 3) & ~3ULL;
+            const char *name = note + sizeof(Elf64_Nhdr);
+
+            if (name_len + desc_len > left - sizeof(Elf64_Nhdr)) {
+                break;
+            }
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+                table->build_id_len = nhdr->n_descsz < BUILD_ID_MAX ? (int)nhdr->n_descsz : BUILD_ID_MAX;
+                (void)memcpy_s(table->build_id, BUILD_ID_MAX, name + name_len, table->build_id_len);
+                return;
+            }
+            note += sizeof(Elf64_Nhdr) + name_len + desc_len;
+            left -= sizeof(Elf64_Nhdr) + name_len + desc_len;
+        }
+    }
+}
+
+/* Collects the defined functions of .symtab, or of .dynsym if the binary is stripped. */
+static int read_syms(struct elf_table *table, const Elf64_Shdr *shdrs, int shnum)
+{
+    const Elf64_Shdr *symtab = NULL;
+    const Elf64_Shdr *strtab;
+    const Elf64_Sym *syms;
+    const char *strs;
+    uint64_t sym_num;
+
+    for (int i = 0; i < shnum; i++) {
+        if (shdrs[i].sh_type == SHT_SYMTAB || (shdrs[i].sh_type == SHT_DYNSYM && symtab == NULL)) {
+            symtab = &shdrs[i];
+        }
+    }
+    if (symtab == NULL || symtab->sh_link >= (uint32_t)shnum) {
+        return 0;
+    }
+    strtab = &shdrs[symtab->sh_link];
+    if (!in_file(table, symtab->sh_offset, symtab->sh_size) || !in_file(table, strtab->sh_offset, strtab->sh_size) ||
+        strtab->sh_size == 0) {
+        return 0;
+    }
+    strs = (const char *)table->map + strtab->sh_offset;
+    // The names are used in place, so the last one has to be terminated.
+    if (strs[strtab->sh_size - 1] != '\0') {
+        return 0;
+    }
+
+    syms = (const Elf64_Sym *)((const char *)table->map + symtab->sh_offset);
+    sym_num = symtab->sh_size / sizeof(Elf64_Sym);
+    table->syms = (struct sym_entry *)malloc(sizeof(struct sym_entry) * (sym_num + 1));
+    if (table->syms == NULL) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < sym_num; i++) {
+        unsigned char type = ELF64_ST_TYPE(syms[i].st_info);
+
+        if ((type != STT_FUNC && type != STT_GNU_IFUNC) || syms[i].st_shndx == SHN_UNDEF ||
+            syms[i].st_value == 0 || syms[i].st_name >= strtab->sh_size) {
+            continue;
+        }
+        table->syms[table->sym_num].addr = syms[i].st_value;
+        table->syms[table->sym_num].size = syms[i].st_size;
+        table->syms[table->sym_num].name = strs + syms[i].st_name;
+        table->sym_num++;
+    }
+    sort_syms(table);
+
+    return 0;
+}
+
+static int parse_elf(struct elf_table *table)
+{
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)table->map;
+    const Elf64_Shdr *shdrs;
+
+    if (table->map_len < sizeof(Elf64_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+        ehdr->e_phentsize != sizeof(Elf64_Phdr) ||
+        !in_file(table, ehdr->e_shoff, (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr)) ||
+        !in_file(table, ehdr->e_phoff, (uint64_t)ehdr->e_phnum * sizeof(Elf64_Phdr))) {
+        return -1;
+    }
+
+    table->phdrs = (const Elf64_Phdr *)((const char *)table->map + ehdr->e_phoff);
+    table->phdr_num = ehdr->e_phnum;
+    shdrs = (const Elf64_Shdr *)((const char *)table->map + ehdr->e_shoff);
+    read_build_id(table, shdrs, ehdr->e_shnum);
+
+    return read_syms(table, shdrs, ehdr->e_shnum);
+}
+
+static struct elf_table *find_build_id(const struct elf_table *table)
+{
+    for (struct elf_table *t = tables; t != NULL; t = t->next) {
+        if (t != kernel && t->build_id_len == table->build_id_len &&
+            memcmp(t->build_id, table->build_id, table->build_id_len) == 0) {
+            return t;
+        }
+    }
+
+    return NULL;
+}
+
+/* Maps the binary through the root of pid, so files of containers are found too. */
+static struct elf_table *load_elf(int pid, const char *path)
+{
+    char full_path[PATH_MAX];
+    struct elf_table *table;
+    struct elf_table *same;
+    struct stat st;
+    int fd;
+
+    if (snprintf_truncated_s(full_path, PATH_MAX, "/proc/%d/root%s", pid, path) >= PATH_MAX - 1) {
+        return NULL;
+    }
+    fd = open(full_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    table = (struct elf_table *)calloc(1, sizeof(struct elf_table));
+    if (table == NULL || fstat(fd, &st) != 0 || st.st_size <= 0) {
+        goto err;
+    }
+    table->map_len = (size_t)st.st_size;
+    table->map = mmap(NULL, table->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (table->map == MAP_FAILED) {
+        table->map = NULL;
+        goto err;
+    }
+    close(fd);
+    fd = -1;
+
+    table->path = strdup(path);
+    if (table->path == NULL || parse_elf(table) != 0) {
+        goto err;
+    }
+    // Another path or inode of the same binary, such as a copy in a container image.
+    if (table->build_id_len > 0) {
+        same = find_build_id(table);
+        if (same != NULL) {
+            free_table(table);
+            return same;
+        }
+    }
+
+    table->next = tables;
+    tables = table;
+    table_num++;
+    return table;
+
+err:
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (table != NULL) {
+        free_table(table);
+    }
+    return NULL;
+}
+
+static struct elf_table *get_elf(int pid, unsigned long dev, unsigned long ino, const char *path)
+{
+    struct elf_file *file;
+
+    for (file = files; file != NULL; file = file->next) {
+        if (file->dev == dev && file->ino == ino) {
+            return file->table;
+        }
+    }
+
+    file = (struct elf_file *)malloc(sizeof(struct elf_file));
+    if (file == NULL) {
+        return NULL;
+    }
+    file->dev = dev;
+    file->ino = ino;
+    file->table = load_elf(pid, path);
+    file->next = files;
+    files = file;
+
+    return file->table;
+}
+
+static int kallsyms_name(struct elf_table *table, size_t *cap, size_t *len, const char *name)
+{
+    size_t n = strlen(name) + 1;
+    char *names;
+
+    if (*len + n > *cap) {
+        size_t new_cap = *cap == 0 ? 1 << 20 : *cap * 2;
+
+        names = (char *)realloc(table->names, new_cap);
+        if (names == NULL) {
+            return -1;
+        }
+        table->names = names;
+        *cap = new_cap;
+    }
+    (void)memcpy_s(table->names + *len, *cap - *len, name, n);
+    *len += n;
+
+    return 0;
+}
+
+/* kallsyms lists zero addresses unless kptr_restrict allows us to see them. */
+static struct elf_table *load_kallsyms(void)
+{
+    char line[KALLSYMS_LINE_LEN];
+    struct elf_table *table;
+    size_t names_cap = 0;
+    size_t names_len = 0;
+    int syms_cap = 0;
+    FILE *file;
+
+    file = fopen(KALLSYMS_PATH, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+    table = (struct elf_table *)calloc(1, sizeof(struct elf_table));
+    if (table == NULL || (table->path = strdup(KERNEL_MODULE)) == NULL) {
+        goto err;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        // "<addr> <type> <name>[\t[module]]"
+        char *p = line;
+        unsigned long addr = strtoul(p, &p, 16);
+        char *name;
+        char type;
+
+        if (*p != ' ' || addr == 0) {
+            continue;
+        }
+        type = p[1];
+        if ((type != 't' && type != 'T' && type != 'w' && type != 'W') || p[2] != ' ') {
+            continue;
+        }
+        name = p + 3;
+        name[strcspn(name, " \t\n")] = '\0';
+        if (*name == '\0') {
+            continue;
+        }
+        if (table->sym_num == syms_cap) {
+            int new_cap = syms_cap == 0 ? 65536 : syms_cap * 2;
+            struct sym_entry *syms = (struct sym_entry *)realloc(table->syms, sizeof(struct sym_entry) * new_cap);
+
+            if (syms == NULL) {
+                goto err;
+            }
+            table->syms = syms;
+            syms_cap = new_cap;
+        }
+        // Offsets until the names stop moving.
+        table->syms[table->sym_num].addr = addr;
+        table->syms[table->sym_num].size = 0;
+        table->syms[table->sym_num].name = (const char *)(uintptr_t)names_len;
+        if (kallsyms_name(table, &names_cap, &names_len, name) != 0) {
+            goto err;
+        }
+        table->sym_num++;
+    }
+    fclose(file);
+    file = NULL;
+
+    if (table->sym_num == 0) {
+        goto err;
+    }
+    for (int i = 0; i < table->sym_num; i++) {
+        table->syms[i].name = table->names + (uintptr_t)table->syms[i].name;
+    }
+    sort_syms(table);
+
+    table->next = tables;
+    tables = table;
+    table_num++;
+    return table;
+
+err:
+    if (file != NULL) {
+        fclose(file);
+    }
+    if (table != NULL) {
+        free_table(table);
+    }
+    return NULL;
+}
+
+static void free_proc(struct proc_maps *proc)
+{
+    free(proc->maps);
+    free(proc);
+}
+
+static int add_map(struct proc_maps *proc, int *cap, const struct proc_map *map)
+{
+    if (proc->num == *cap) {
+        int new_cap = *cap == 0 ? 16 : *cap * 2;
+        struct proc_map *maps = (struct proc_map *)realloc(proc->maps, sizeof(struct proc_map) * new_cap);
+
+        if (maps == NULL) {
+            return -1;
+        }
+        proc->maps = maps;
+        *cap = new_cap;
+    }
+    proc->maps[proc->num++] = *map;
+
+    return 0;
+}
+
+/* Reads the file backed executable mappings of /proc/pid/maps. */
+static int load_maps(struct proc_maps *proc)
+{
+    char path[PATH_MAX];
+    char line[MAPS_LINE_LEN];
+    FILE *file;
+    int cap = 0;
+
+    if (snprintf_truncated_s(path, PATH_MAX, "/proc/%d/maps", proc->pid) < 0) {
+        return -1;
+    }
+    proc->num = 0;
+    proc->loaded_ms = now_ms();
+    file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        // "<start>-<end> <perms> <offset> <major>:<minor> <inode> <path>"
+        struct proc_map map;
+        char *p = line;
+        unsigned long start = strtoul(p, &p, 16);
+        unsigned long end = *p == '-' ? strtoul(p + 1, &p, 16) : 0;
+        unsigned long offset, major, minor, ino;
+        char *perms = p + 1;
+
+        if (*p != ' ' || end <= start || strlen(perms) < 5 || perms[2] != 'x') {
+            continue;
+        }
+        offset = strtoul(perms + 5, &p, 16);
+        major = strtoul(p + 1, &p, 16);
+        minor = *p == ':' ? strtoul(p + 1, &p, 16) : 0;
+        ino = strtoul(p + 1, &p, 10);
+        if (ino == 0) {
+            continue;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+        p[strcspn(p, "\n")] = '\0';
+        // Replaced or removed files cannot be opened by their name any more.
+        if (p[0] != '/' || strstr(p, " (deleted)") != NULL) {
+            continue;
+        }
+
+        map.start = start;
+        map.end = end;
+        map.offset = offset;
+        map.elf = get_elf(proc->pid, (major << 32) | minor, ino, p);
+        if (add_map(proc, &cap, &map) != 0) {
+            break;
+        }
+    }
+    fclose(file);
+
+    return 0;
+}
+
+static struct proc_maps *get_proc(int pid)
+{
+    struct proc_maps **bucket = &procs[(unsigned)pid % PROC_BUCKETS];
+    struct proc_maps *proc;
+
+    for (proc = *bucket; proc != NULL; proc = proc->next) {
+        if (proc->pid == pid) {
+            return proc;
+        }
+    }
+
+    proc = (struct proc_maps *)calloc(1, sizeof(struct proc_maps));
+    if (proc == NULL) {
+        return NULL;
+    }
+    proc->pid = pid;
+    // An exited process stays without mappings, its late samples do not reopen the maps.
+    (void)load_maps(proc);
+    proc->next = *bucket;
+    *bucket = proc;
+    proc_num++;
+
+    return proc;
+}
+
+static const struct proc_map *find_map(const struct proc_maps *proc, uint64_t addr)
+{
+    int lo = 0;
+    int hi = proc->num;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+
+        if (proc->maps[mid].end <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == proc->num || proc->maps[lo].start > addr) {
+        return NULL;
+    }
+
+    return &proc->maps[lo];
+}
+
+/* The symbol address of a file offset, through the segment that loads it. */
+static bool offset_to_addr(const struct elf_table *table, uint64_t offset, uint64_t *addr)
+{
+    for (int i = 0; i < table->phdr_num; i++) {
+        const Elf64_Phdr *phdr = &table->phdrs[i];
+
+        if (phdr->p_type == PT_LOAD && offset >= phdr->p_offset && offset - phdr->p_offset < phdr->p_filesz) {
+            *addr = offset - phdr->p_offset + phdr->p_vaddr;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static const struct sym_entry *resolve(const struct elf_table *table, uint64_t offset)
+{
+    uint64_t key = ((uint64_t)(uintptr_t)table >> 4) ^ (offset * 0x9e3779b97f4a7c15ULL);
+    struct symbol_slot *slot = &symbol_cache[(key >> 52) & (SYMBOL_CACHE_SIZE - 1)];
+    uint64_t addr = offset;
+
+    if (slot->elf == table && slot->offset == offset) {
+        return slot->sym;
+    }
+
+    slot->elf = table;
+    slot->offset = offset;
+    slot->sym = NULL;
+    if (table == kernel || offset_to_addr(table, offset, &addr)) {
+        slot->sym = find_sym(table, addr);
+    }
+
+    return slot->sym;
+}
+
+/* Kernel addresses have the top bit set on both arm64 and x86_64. */
+static bool is_kernel(uint64_t addr)
+{
+    return (addr >> 63) != 0;
+}
+
+static int lookup(int pid, uint64_t addr, const struct elf_table **table, uint64_t *offset,
+    const struct sym_entry **sym)
+{
+    const struct proc_map *map;
+    struct proc_maps *proc;
+
+    if (is_kernel(addr)) {
+        if (!kernel_loaded) {
+            kernel = load_kallsyms();
+            kernel_loaded = true;
+        }
+        if (kernel == NULL) {
+            return -1;
+        }
+        *table = kernel;
+        *offset = addr;
+        *sym = resolve(kernel, addr);
+        return 0;
+    }
+
+    proc = get_proc(pid);
+    if (proc == NULL) {
+        return -1;
+    }
+    proc->used_ms = now_ms();
+    map = find_map(proc, addr);
+    // Something was mapped since, but do not reread the maps for every stray sample.
+    if (map == NULL && proc->used_ms - proc->loaded_ms >= TRIM_INTERVAL_MS && load_maps(proc) == 0) {
+        map = find_map(proc, addr);
+    }
+    if (map == NULL || map->elf == NULL) {
+        return -1;
+    }
+
+    *table = map->elf;
+    *offset = addr - map->start + map->offset;
+    *sym = resolve(map->elf, *offset);
+    return 0;
+}
+
+int pmu_symbol_lookup(int pid, uint64_t addr, const char **symbol, const char **module)
+{
+    const struct elf_table *table;
+    const struct sym_entry *sym;
+    uint64_t offset;
+    int ret;
+
+    pthread_mutex_lock(&symbol_lock);
+    ret = lookup(pid, addr, &table, &offset, &sym);
+    pthread_mutex_unlock(&symbol_lock);
+    if (ret != 0) {
+        return -1;
+    }
+
+    *symbol = sym == NULL ? NULL : sym->name;
+    *module = table->path;
+    return 0;
+}
+
+static void copy_name(char *dst, size_t size, const char *src)
+{
+    size_t n = strnlen(src, size - 1);
+
+    (void)memcpy_s(dst, size, src, n);
+    dst[n] = '\0';
+}
+
+int PmuResolveSymbol(int pid, uint64_t addr, struct PmuSymbolInfo *info)
+{
+    const struct elf_table *table;
+    const struct sym_entry *sym;
+    const char *module;
+    uint64_t offset;
+
+    (void)memset_s(info, sizeof(struct PmuSymbolInfo), 0, sizeof(struct PmuSymbolInfo));
+
+    // The names are copied under the lock, the engine thread may trim the cache right after.
+    pthread_mutex_lock(&symbol_lock);
+    if (lookup(pid, addr, &table, &offset, &sym) != 0) {
+        pthread_mutex_unlock(&symbol_lock);
+        return -1;
+    }
+    if (sym != NULL) {
+        copy_name(info->symbol, sizeof(info->symbol), sym->name);
+    }
+    module = strrchr(table->path, '/');
+    copy_name(info->module, sizeof(info->module), module == NULL ? table->path : module + 1);
+    for (int i = 0; i < table->build_id_len; i++) {
+        (void)snprintf_truncated_s(&info->buildId[i * 2], sizeof(info->buildId) - i * 2, "%02x",
+            table->build_id[i]);
+    }
+    info->offset = offset;
+    pthread_mutex_unlock(&symbol_lock);
+
+    return 0;
+}
+
+static void drop_procs(uint64_t idle_before)
+{
+    for (int i = 0; i < PROC_BUCKETS; i++) {
+        struct proc_maps **link = &procs[i];
+
+        while (*link != NULL) {
+            struct proc_maps *proc = *link;
+
+            if (proc->used_ms >= idle_before) {
+                link = &proc->next;
+                continue;
+            }
+            *link = proc->next;
+            free_proc(proc);
+            proc_num--;
+        }
+    }
+}
+
+static void drop_all(void)
+{
+    drop_procs(UINT64_MAX);
+    while (files != NULL) {
+        struct elf_file *file = files;
+
+        files = file->next;
+        free(file);
+    }
+    while (tables != NULL) {
+        struct elf_table *table = tables;
+
+        tables = table->next;
+        free_table(table);
+    }
+    table_num = 0;
+    kernel = NULL;
+    kernel_loaded = false;
+    (void)memset_s(symbol_cache, sizeof(symbol_cache), 0, sizeof(symbol_cache));
+}
+
+void pmu_symbol_trim(void)
+{
+    uint64_t now = now_ms();
+
+    if (now - last_trim_ms < TRIM_INTERVAL_MS) {
+        return;
+    }
+    last_trim_ms = now;
+
+    pthread_mutex_lock(&symbol_lock);
+    // An exited pid may be reused by a process with other mappings.
+    if (now > PROC_IDLE_MS) {
+        drop_procs(now - PROC_IDLE_MS);
+    }
+    if (proc_num > PROC_CACHE_MAX || table_num > ELF_CACHE_MAX) {
+        drop_all();
+    }
+    pthread_mutex_unlock(&symbol_lock);
+}
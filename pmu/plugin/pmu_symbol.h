@@ -0,0 +1,40 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef __PMU_SYMBOL_H__
+#define __PMU_SYMBOL_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Symbol cache for the samples of instances opened with NO_SYMBOL_RESOLVE. Binaries are
+ * mmap'ed once per build-id and their function symbols sorted by address; an address is only
+ * resolved when asked for, and repeated (build-id, offset) pairs hit a direct mapped cache.
+ */
+
+/* Resolves addr of process pid. symbol and module stay valid until the next pmu_symbol_trim,
+ * symbol is NULL if the address is in no known function. Returns -1 if it is in no mapping.
+ */
+int pmu_symbol_lookup(int pid, uint64_t addr, const char **symbol, const char **module);
+/* Called from the engine thread between reads: forgets processes not asked about for a while
+ * and drops everything once the cache is over its bounds.
+ */
+void pmu_symbol_trim(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
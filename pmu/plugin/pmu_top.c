@@ -0,0 +1,256 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <securec.h>
+#include "pmu.h"
+#include "pmu_plugin.h"
+#include "pmu_engine.h"
+#include "pmu_symbol.h"
+#include "pmu_top.h"
+
+#define FNV_OFFSET  0xcbf29ce484222325ULL
+#define FNV_PRIME   0x100000001b3ULL
+#define MIN_BUCKETS 64
+
+/* One (pid, function) of the interval. The strings point into the PmuData being folded. */
+struct top_entry {
+    int pid;
+    uint64_t hash;
+    const char *comm;
+    const char *symbol;
+    const char *module;
+    unsigned long addr;
+    uint64_t samples;
+    uint64_t period;
+};
+
+/* Open addressing table kept across intervals, only the buckets used are cleared. */
+static int *buckets = NULL;
+static unsigned bucket_mask = 0;
+static struct top_entry *entries = NULL;
+static int entry_cap = 0;
+static int entry_num = 0;
+
+static uint64_t hash_str(uint64_t h, const char *s)
+{
+    while (*s != '\0') {
+        h = (h ^ (unsigned char)*s++) * FNV_PRIME;
+    }
+    return h;
+}
+
+static uint64_t hash_key(int pid, const char *symbol, const char *module, unsigned long addr)
+{
+    uint64_t h = (FNV_OFFSET ^ (uint32_t)pid) * FNV_PRIME;
+
+    if (symbol == NULL) {
+        return (h ^ addr) * FNV_PRIME;
+    }
+    h = hash_str(h, symbol);
+    return hash_str(h, module == NULL ? "" : module);
+}
+
+static bool same_str(const char *a, const char *b)
+{
+    // libkperf hands out one cached Symbol per function, so the pointers usually match.
+    if (a == b) {
+        return true;
+    }
+    if (a == NULL || b == NULL) {
+        return false;
+    }
+    return strcmp(a, b) == 0;
+}
+
+static bool same_key(const struct top_entry *e, uint64_t hash, int pid, const char *symbol, const char *module,
+    unsigned long addr)
+{
+    if (e->hash != hash || e->pid != pid) {
+        return false;
+    }
+    if (symbol == NULL) {
+        return e->symbol == NULL && e->addr == addr;
+    }
+    return same_str(e->symbol, symbol) && same_str(e->module, module);
+}
+
+/* Room for len distinct keys at a load factor of at most one half. */
+static int reserve_table(int len)
+{
+    unsigned size = MIN_BUCKETS;
+    int *new_buckets;
+    struct top_entry *new_entries;
+
+    if (len > entry_cap) {
+        new_entries = (struct top_entry *)realloc(entries, sizeof(struct top_entry) * len);
+        if (new_entries == NULL) {
+            return -1;
+        }
+        entries = new_entries;
+        entry_cap = len;
+    }
+
+    while (size < (unsigned)len * 2) {
+        size <<= 1;
+    }
+    if (size <= bucket_mask + 1 && buckets != NULL) {
+        return 0;
+    }
+    new_buckets = (int *)malloc(sizeof(int) * size);
+    if (new_buckets == NULL) {
+        return -1;
+    }
+    for (unsigned i = 0; i < size; i++) {
+        new_buckets[i] = -1;
+    }
+    free(buckets);
+    buckets = new_buckets;
+    bucket_mask = size - 1;
+
+    return 0;
+}
+
+static void clear_table(void)
+{
+    for (int i = 0; i < entry_num; i++) {
+        unsigned b = (unsigned)entries[i].hash & bucket_mask;
+
+        while (buckets[b] != -1) {
+            buckets[b] = -1;
+            b = (b + 1) & bucket_mask;
+        }
+    }
+    entry_num = 0;
+}
+
+static void fold_sample(const struct PmuData *data)
+{
+    const struct Symbol *sym = data->stack == NULL ? NULL : data->stack->symbol;
+    const char *symbol = sym == NULL ? NULL : sym->symbolName;
+    const char *module = sym == NULL ? NULL : sym->module;
+    unsigned long addr = sym == NULL ? 0 : sym->addr;
+    uint64_t hash;
+    unsigned b;
+    struct top_entry *e;
+
+    // Opened with symbol_mode = raw, the cache resolves a hot function once.
+    if (sym != NULL && symbol == NULL && pmu_symbol_lookup(data->pid, addr, &symbol, &module) != 0) {
+        symbol = NULL;
+        module = NULL;
+    }
+    hash = hash_key(data->pid, symbol, module, addr);
+    b = (unsigned)hash & bucket_mask;
+
+    while (buckets[b] != -1) {
+        e = &entries[buckets[b]];
+        if (same_key(e, hash, data->pid, symbol, module, addr)) {
+            e->samples++;
+            e->period += data->period;
+            return;
+        }
+        b = (b + 1) & bucket_mask;
+    }
+
+    buckets[b] = entry_num;
+    e = &entries[entry_num++];
+    e->pid = data->pid;
+    e->hash = hash;
+    e->comm = data->comm;
+    e->symbol = symbol;
+    e->module = module;
+    e->addr = addr;
+    e->samples = 1;
+    e->period = data->period;
+}
+
+static int hotter(const void *a, const void *b)
+{
+    const struct top_entry *x = (const struct top_entry *)a;
+    const struct top_entry *y = (const struct top_entry *)b;
+
+    if (x->samples != y->samples) {
+        return x->samples < y->samples ? 1 : -1;
+    }
+    if (x->period != y->period) {
+        return x->period < y->period ? 1 : -1;
+    }
+    return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+static void copy_name(char *dst, size_t size, const char *src)
+{
+    size_t n;
+
+    if (src == NULL) {
+        dst[0] = '\0';
+        return;
+    }
+    n = strnlen(src, size - 1);
+    (void)memcpy_s(dst, size, src, n);
+    dst[n] = '\0';
+}
+
+static void fill_top(struct PmuSymbolTop *top, const struct top_entry *e)
+{
+    const char *module = e->module == NULL ? NULL : strrchr(e->module, '/');
+
+    top->pid = e->pid;
+    top->samples = e->samples;
+    top->period = e->period;
+    top->addr = e->addr;
+    copy_name(top->comm, sizeof(top->comm), e->comm);
+    copy_name(top->symbol, sizeof(top->symbol), e->symbol);
+    copy_name(top->module, sizeof(top->module), module == NULL ? e->module : module + 1);
+}
+
+int pmu_top_aggregate(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data)
+{
+    struct PmuSymbolTop *top;
+    int limit = desc->out_limit > 0 ? desc->out_limit : PMU_TOP_DEFAULT_N;
+    int num;
+
+    (void)interval_ns;
+    *out = NULL;
+    *free_data = NULL;
+    if (len <= 0) {
+        return 0;
+    }
+
+    if (buckets != NULL) {
+        clear_table();
+    }
+    if (reserve_table(len) != 0) {
+        printf("malloc sampling top table failed\n");
+        return 0;
+    }
+    for (int i = 0; i < len; i++) {
+        fold_sample(&data[i]);
+    }
+
+    qsort(entries, entry_num, sizeof(struct top_entry), hotter);
+    num = entry_num < limit ? entry_num : limit;
+    top = (struct PmuSymbolTop *)malloc(sizeof(struct PmuSymbolTop) * num);
+    if (top == NULL) {
+        printf("malloc sampling top failed\n");
+        return 0;
+    }
+    for (int i = 0; i < num; i++) {
+        fill_top(&top[i], &entries[i]);
+    }
+
+    *out = top;
+    *free_data = free;
+    return num;
+}
@@ -9,24 +9,26 @@
  * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
  * See the Mulan PSL v2 for more details.
  ******************************************************************************/
-#ifndef __PLUGIN_COUNTING_H__
-#define __PLUGIN_COUNTING_H__
+#ifndef __PMU_TOP_H__
+#define __PMU_TOP_H__
+
+#include <stdint.h>
+#include "plugin_comm.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-const char *counting_get_version();
-const char *counting_get_name();
-const char *counting_get_description();
-const char *counting_get_dep();
-int counting_get_priority();
-int counting_get_type();
-int counting_get_period();
-bool counting_enable();
-void counting_disable();
-const struct DataRingBuf *counting_get_ring_buf();
-void counting_run(const struct Param *param);
+#define PMU_TOP_DEFAULT_N 64
+
+struct PmuData;
+struct pmu_instance_desc;
+
+/* pmu_instance_desc transform: folds the samples of one interval by (pid, leaf symbol) into
+ * the out_limit hottest PmuSymbolTop entries.
+ */
+int pmu_top_aggregate(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,210 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <securec.h>
+#include "pmu.h"
+#include "pmu_plugin.h"
+#include "pmu_engine.h"
+#include "pmu_uncore.h"
+#include "pmu_traffic.h"
+
+#define NSEC_PER_SEC       1000000000.0
+#define NSEC_PER_USEC      1000
+/* An HHA request moves one cache line. */
+#define HHA_LINE_BYTES     64
+
+enum traffic_event {
+    TRAFFIC_OPS,
+    TRAFFIC_SCCL,
+    TRAFFIC_OUTER,
+    TRAFFIC_EVENT_MAX,
+};
+
+/* As opened by uncore_get_events, with the trailing '/'. */
+static const char *const traffic_events[TRAFFIC_EVENT_MAX] = {
+    [TRAFFIC_OPS] = "rx_ops_num/",
+    [TRAFFIC_SCCL] = "rx_sccl/",
+    [TRAFFIC_OUTER] = "rx_outer/",
+};
+
+/* The HHA units, found on first use, and the sockets they are on in ascending order. */
+static struct uncore_unit *hhas = NULL;
+static int hha_num = 0;
+static int *sockets = NULL;
+static int socket_num = 0;
+static uint64_t (*counts)[TRAFFIC_EVENT_MAX] = NULL;
+static bool units_loaded = false;
+
+static void add_socket(int socket)
+{
+    int i = 0;
+
+    while (i < socket_num && sockets[i] < socket) {
+        i++;
+    }
+    if (i < socket_num && sockets[i] == socket) {
+        return;
+    }
+    (void)memmove_s(&sockets[i + 1], sizeof(int) * (socket_num - i), &sockets[i], sizeof(int) * (socket_num - i));
+    sockets[i] = socket;
+    socket_num++;
+}
+
+static void load_units(void)
+{
+    struct uncore_unit *units = NULL;
+    int num;
+
+    units_loaded = true;
+    num = uncore_discover(uncore_sysfs_root(), &units);
+    if (num <= 0) {
+        free(units);
+        return;
+    }
+    // Sorted by type, and the HHAs come first.
+    while (hha_num < num && units[hha_num].type == UNCORE_HHA) {
+        hha_num++;
+    }
+    sockets = (int *)malloc(sizeof(int) * (hha_num + 1));
+    counts = calloc(hha_num + 1, sizeof(*counts));
+    if (hha_num == 0 || sockets == NULL || counts == NULL) {
+        free(units);
+        free(sockets);
+        free(counts);
+        sockets = NULL;
+        counts = NULL;
+        hha_num = 0;
+        return;
+    }
+
+    hhas = units;
+    for (int i = 0; i < hha_num; i++) {
+        add_socket(hhas[i].socket);
+    }
+}
+
+static int find_hha(const char *name, int hint)
+{
+    if (hint < hha_num && strcmp(hhas[hint].name, name) == 0) {
+        return hint;
+    }
+    for (int i = 0; i < hha_num; i++) {
+        if (strcmp(hhas[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void sum_counts(const struct PmuData *data, int len)
+{
+    char unit[UNCORE_NAME_SIZE];
+    const char *event;
+    int hha = 0;
+
+    (void)memset_s(counts, sizeof(*counts) * hha_num, 0, sizeof(*counts) * hha_num);
+    for (int i = 0; i < len; i++) {
+        if (data[i].evt == NULL || uncore_parse_event(data[i].evt, unit, sizeof(unit), &event) != 0) {
+            continue;
+        }
+        // The units of one event follow each other, try the next one first.
+        hha = find_hha(unit, hha + 1);
+        if (hha < 0) {
+            hha = 0;
+            continue;
+        }
+        for (int e = 0; e < TRAFFIC_EVENT_MAX; e++) {
+            if (strcmp(event, traffic_events[e]) == 0) {
+                counts[hha][e] += data[i].count;
+                break;
+            }
+        }
+    }
+}
+
+static void fill_row(struct PmuUncoreTraffic *row, const uint64_t *count, uint32_t interval_us, double per_sec)
+{
+    double ops = (double)count[TRAFFIC_OPS];
+
+    row->intervalUs = interval_us;
+    row->ops = count[TRAFFIC_OPS];
+    row->scclOps = count[TRAFFIC_SCCL];
+    row->outerOps = count[TRAFFIC_OUTER];
+    row->scclRatio = ops > 0 ? (double)row->scclOps / ops : 0;
+    row->outerRatio = ops > 0 ? (double)row->outerOps / ops : 0;
+    row->bytesPerSec = ops * HHA_LINE_BYTES * per_sec;
+    row->scclBytesPerSec = (double)row->scclOps * HHA_LINE_BYTES * per_sec;
+    row->outerBytesPerSec = (double)row->outerOps * HHA_LINE_BYTES * per_sec;
+}
+
+int pmu_traffic_derive(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data)
+{
+    struct PmuUncoreTraffic *rows;
+    double per_sec = interval_ns > 0 ? NSEC_PER_SEC / (double)interval_ns : 0;
+    uint32_t interval_us = (uint32_t)(interval_ns / NSEC_PER_USEC);
+    int num;
+
+    (void)desc;
+    *out = NULL;
+    *free_data = NULL;
+
+    if (!units_loaded) {
+        load_units();
+    }
+    if (hha_num == 0) {
+        return 0;
+    }
+    num = hha_num + socket_num;
+    rows = (struct PmuUncoreTraffic *)calloc(num, sizeof(struct PmuUncoreTraffic));
+    if (rows == NULL) {
+        printf("malloc uncore traffic failed\n");
+        return 0;
+    }
+
+    sum_counts(data, len);
+    for (int i = 0; i < hha_num; i++) {
+        rows[i].scope = PMU_TRAFFIC_HHA;
+        rows[i].socket = hhas[i].socket;
+        rows[i].sccl = hhas[i].sccl;
+        rows[i].index = hhas[i].index;
+        rows[i].node = hhas[i].node;
+        fill_row(&rows[i], counts[i], interval_us, per_sec);
+    }
+    for (int s = 0; s < socket_num; s++) {
+        uint64_t *total = counts[hha_num];
+        struct PmuUncoreTraffic *row = &rows[hha_num + s];
+
+        (void)memset_s(total, sizeof(*counts), 0, sizeof(*counts));
+        for (int i = 0; i < hha_num; i++) {
+            if (hhas[i].socket != sockets[s]) {
+                continue;
+            }
+            for (int e = 0; e < TRAFFIC_EVENT_MAX; e++) {
+                total[e] += counts[i][e];
+            }
+        }
+        row->scope = PMU_TRAFFIC_SOCKET;
+        row->socket = sockets[s];
+        row->sccl = -1;
+        row->index = -1;
+        row->node = -1;
+        fill_row(row, total, interval_us, per_sec);
+    }
+
+    *out = rows;
+    *free_data = free;
+    return num;
+}
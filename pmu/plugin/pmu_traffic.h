@@ -9,24 +9,24 @@
  * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
  * See the Mulan PSL v2 for more details.
  ******************************************************************************/
-#ifndef __PLUGIN_NETIF_RX_H__
-#define __PLUGIN_NETIF_RX_H__
+#ifndef __PMU_TRAFFIC_H__
+#define __PMU_TRAFFIC_H__
+
+#include <stdint.h>
+#include "plugin_comm.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-const char *netif_rx_get_version();
-const char *netif_rx_get_name();
-const char *netif_rx_get_description();
-const char *netif_rx_get_dep();
-int netif_rx_get_priority();
-int netif_rx_get_type();
-int netif_rx_get_period();
-bool netif_rx_enable();
-void netif_rx_disable();
-const struct DataRingBuf *netif_rx_get_ring_buf();
-void netif_rx_run(const struct Param *param);
+struct PmuData;
+struct pmu_instance_desc;
+
+/* pmu_instance_desc transform: turns the hha rx_ops_num, rx_sccl and rx_outer deltas of one
+ * interval into PmuUncoreTraffic rows per HHA and per socket.
+ */
+int pmu_traffic_derive(const struct pmu_instance_desc *desc, const struct PmuData *data, int len,
+    uint64_t interval_ns, void **out, data_free_fn *free_data);
 
 #ifdef __cplusplus
 }
@@ -13,130 +13,347 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
+#include <unistd.h>
 #include <securec.h>
+#include "pmu.h"
+#include "pmu_engine.h"
 #include "pmu_uncore.h"
 
-static int hha_num = 0;
-static struct uncore_config *uncore_rx_outer = NULL;
-static struct uncore_config *uncore_rx_sccl = NULL;
-static struct uncore_config *uncore_rx_ops_num = NULL;
+#define UNCORE_PREFIX      "hisi_"
+#define CPU_PATH           "/sys/devices/system/cpu"
+#define NODE_PATH          "/sys/devices/system/node"
+#define ID_BUF_SIZE        64
 
-int get_uncore_hha_num()
+/* Unit types by the name the kernel drivers give them: hisi_sccl<N>_<type><M>, or
+ * hisi_sicl<N>_<type><M> on the io dies.
+ */
+static const char *const unit_type_names[UNCORE_UNIT_MAX] = {
+    [UNCORE_HHA] = "hha",
+    [UNCORE_DDRC] = "ddrc",
+    [UNCORE_L3C] = "l3c",
+    [UNCORE_PA] = "pa",
+};
+
+const char *uncore_type_name(enum uncore_unit_type type)
 {
-    return hha_num;
+    return type < UNCORE_UNIT_MAX ? unit_type_names[type] : NULL;
 }
 
-struct uncore_config *get_rx_outer()
+const char *uncore_sysfs_root(void)
 {
-    return uncore_rx_outer;
+    const char *root = getenv(UNCORE_SYSFS_ROOT_ENV);
+
+    return root == NULL ? "" : root;
 }
 
-struct uncore_config *get_rx_sccl()
+/* Reads the leading number of a sysfs file, such as the first cpu of a cpumask. */
+static int read_first_int(const char *path)
 {
-    return uncore_rx_sccl;
+    char buf[ID_BUF_SIZE] = {0};
+    char *end;
+    FILE *file;
+    long n;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    if (fgets(buf, sizeof(buf), file) == NULL) {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    n = strtol(buf, &end, 10);
+    if (end == buf || n < 0) {
+        return -1;
+    }
+    return (int)n;
 }
 
-struct uncore_config *get_rx_ops_num()
+static int parse_number(const char **p)
 {
-    return uncore_rx_ops_num;
+    char *end;
+    long n = strtol(*p, &end, 10);
+
+    if (end == *p || n < 0) {
+        return -1;
+    }
+    *p = end;
+    return (int)n;
 }
 
-static int read_single_uncore_event(const char *hha_name, struct uncore_config *uncore_event, const char *event_name)
+/* Fills type, sccl and index from a pmu name, returns -1 if it is no known uncore unit. */
+static int parse_unit_name(const char *name, struct uncore_unit *unit)
 {
-    char hha_path[MAX_PATH_LEN] = {0};
+    const char *p = name;
 
-    // Read cfg
-    snprintf_truncated_s(hha_path, MAX_PATH_LEN, "%s/%s/", hha_name, event_name);
-    
-    strcpy(uncore_event->uncore_name, hha_path);
+    if (strncmp(p, UNCORE_PREFIX, strlen(UNCORE_PREFIX)) != 0) {
+        return -1;
+    }
+    p += strlen(UNCORE_PREFIX);
+    if (strncmp(p, "sccl", strlen("sccl")) != 0 && strncmp(p, "sicl", strlen("sicl")) != 0) {
+        return -1;
+    }
+    p += strlen("sccl");
+    unit->sccl = parse_number(&p);
+    if (unit->sccl < 0 || *p++ != '_') {
+        return -1;
+    }
 
-    return 0;
-}
+    for (int type = 0; type < UNCORE_UNIT_MAX; type++) {
+        size_t len = strlen(unit_type_names[type]);
 
-static void free_namelist(int n, struct dirent **namelist)
-{
-    while (n--) {
-        free(namelist[n]);
+        // Newer drivers add a sub index, hisi_sccl3_ddrc0_1.
+        if (strncmp(p, unit_type_names[type], len) == 0 && p[len] >= '0' && p[len] <= '9') {
+            p += len;
+            unit->type = (enum uncore_unit_type)type;
+            unit->index = parse_number(&p);
+            return 0;
+        }
     }
-    free(namelist);
+
+    return -1;
 }
 
-static int hha_read_uncore_config(int n, struct dirent **namelist)
+static int cpu_node(const char *root, int cpu)
 {
-    int index = 0;
+    char path[MAX_PATH_LEN];
+    struct dirent *ent;
+    DIR *dir;
+    int node = -1;
 
-    while (index < n) {
-        if (read_single_uncore_event(namelist[index]->d_name, &uncore_rx_outer[index], "rx_outer") != 0) {
-            return -1;
-        }
-        if (read_single_uncore_event(namelist[index]->d_name, &uncore_rx_sccl[index], "rx_sccl") != 0) {
-            return -1;
+    (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s%s", root, NODE_PATH);
+    dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+    while (node < 0 && (ent = readdir(dir)) != NULL) {
+        const char *id = ent->d_name + strlen("node");
+
+        if (strncmp(ent->d_name, "node", strlen("node")) != 0 || *id < '0' || *id > '9') {
+            continue;
         }
-        if (read_single_uncore_event(namelist[index]->d_name, &uncore_rx_ops_num[index], "rx_ops_num") != 0) {
-            return -1;
+        (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s%s/%s/cpu%d", root, NODE_PATH, ent->d_name, cpu);
+        if (access(path, F_OK) == 0) {
+            node = parse_number(&id);
         }
+    }
+    closedir(dir);
 
-        index++;
+    return node;
+}
+
+/* The cpumask of an uncore pmu names the cpu its events are counted on, which sits in the
+ * same die, and so gives the socket and the node of the unit.
+ */
+static void read_topology(const char *root, struct uncore_unit *unit)
+{
+    char path[MAX_PATH_LEN];
+
+    unit->socket = -1;
+    unit->node = -1;
+    (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s%s/%s/cpumask", root, DEVICE_PATH, unit->name);
+    unit->cpu = read_first_int(path);
+    if (unit->cpu < 0) {
+        return;
     }
 
-    return 0;
+    (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s%s/cpu%d/topology/physical_package_id", root, CPU_PATH,
+        unit->cpu);
+    unit->socket = read_first_int(path);
+    unit->node = cpu_node(root, unit->cpu);
+}
+
+static int unit_cmp(const void *a, const void *b)
+{
+    const struct uncore_unit *x = (const struct uncore_unit *)a;
+    const struct uncore_unit *y = (const struct uncore_unit *)b;
+
+    if (x->type != y->type) {
+        return x->type < y->type ? -1 : 1;
+    }
+    if (x->sccl != y->sccl) {
+        return x->sccl < y->sccl ? -1 : 1;
+    }
+    if (x->index != y->index) {
+        return x->index < y->index ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
 }
 
-static int hha_scandir_select(const struct dirent *ptr)
+int uncore_discover(const char *root, struct uncore_unit **units)
 {
-    int ret = 0;
-    if (strstr(ptr->d_name, "hha") != NULL) {
-        ret = 1;
+    char path[MAX_PATH_LEN];
+    struct uncore_unit *list = NULL;
+    struct dirent *ent;
+    DIR *dir;
+    int cap = 0;
+    int num = 0;
+
+    *units = NULL;
+    (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s%s", root, DEVICE_PATH);
+    dir = opendir(path);
+    if (dir == NULL) {
+        printf("open %s failed\n", path);
+        return -1;
     }
 
-    return ret;
+    while ((ent = readdir(dir)) != NULL) {
+        struct uncore_unit unit;
+
+        (void)memset_s(&unit, sizeof(unit), 0, sizeof(unit));
+        if (strlen(ent->d_name) >= UNCORE_NAME_SIZE || parse_unit_name(ent->d_name, &unit) != 0) {
+            continue;
+        }
+        if (num == cap) {
+            struct uncore_unit *grown;
+
+            cap = cap == 0 ? 16 : cap * 2;
+            grown = (struct uncore_unit *)realloc(list, sizeof(struct uncore_unit) * cap);
+            if (grown == NULL) {
+                free(list);
+                closedir(dir);
+                return -1;
+            }
+            list = grown;
+        }
+        (void)strcpy_s(unit.name, UNCORE_NAME_SIZE, ent->d_name);
+        read_topology(root, &unit);
+        list[num++] = unit;
+    }
+    closedir(dir);
+
+    if (num > 0) {
+        qsort(list, num, sizeof(struct uncore_unit), unit_cmp);
+    }
+    *units = list;
+    return num;
 }
 
-int hha_uncore_config_init(void)
+/* Splits "<type>/<event>", returns the type or -1. */
+static int parse_template(const char *tmpl, const char **event)
 {
-    int ret;
-    struct dirent **namelist;
+    const char *slash = strchr(tmpl, '/');
 
-    hha_num = scandir(DEVICE_PATH, &namelist, hha_scandir_select, alphasort);
-    if (hha_num <= 0) {
-        printf("scandir failed\n");
+    if (slash == NULL || slash[1] == '\0' || strchr(slash + 1, '/') != NULL) {
         return -1;
     }
+    for (int type = 0; type < UNCORE_UNIT_MAX; type++) {
+        if ((size_t)(slash - tmpl) == strlen(unit_type_names[type]) &&
+            strncmp(tmpl, unit_type_names[type], slash - tmpl) == 0) {
+            *event = slash + 1;
+            return type;
+        }
+    }
+
+    return -1;
+}
+
+/* Drivers of other versions name some events differently, only open those a unit lists. */
+static bool unit_has_event(const char *root, const struct uncore_unit *unit, const char *event)
+{
+    char path[MAX_PATH_LEN];
+
+    (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s%s/%s/events", root, DEVICE_PATH, unit->name);
+    if (access(path, F_OK) != 0) {
+        return true;
+    }
+    (void)snprintf_truncated_s(path, MAX_PATH_LEN, "%s%s/%s/events/%s", root, DEVICE_PATH, unit->name, event);
+    return access(path, F_OK) == 0;
+}
+
+static int unit_name_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct uncore_unit *)a)->name, ((const struct uncore_unit *)b)->name);
+}
+
+static int expand_events(const struct pmu_instance_desc *desc, bool by_name, char ***evt_list, int *evt_num)
+{
+    const char *root = uncore_sysfs_root();
+    struct uncore_unit *units;
+    char (*names)[UNCORE_NAME_SIZE];
+    char **list;
+    size_t max;
+    int unit_num;
+    int num = 0;
 
-    uncore_rx_outer = (struct uncore_config *)calloc(hha_num, sizeof(struct uncore_config));
-    if (uncore_rx_outer == NULL) {
-        free_namelist(hha_num, namelist);
+    unit_num = uncore_discover(root, &units);
+    if (unit_num <= 0) {
+        free(units);
         return -1;
     }
-    uncore_rx_sccl = (struct uncore_config *)calloc(hha_num, sizeof(struct uncore_config));
-    if (uncore_rx_sccl == NULL) { // free uncore_rx_sccl in function uncore_config_fini
-        free_namelist(hha_num, namelist);
+    if (by_name) {
+        qsort(units, unit_num, sizeof(struct uncore_unit), unit_name_cmp);
+    }
+    // The names follow the pointers in one block, every member of a group owns its list.
+    max = (size_t)unit_num * desc->evt_num;
+    list = (char **)calloc(1, max * (sizeof(char *) + UNCORE_NAME_SIZE));
+    if (list == NULL) {
+        free(units);
         return -1;
     }
-    uncore_rx_ops_num = (struct uncore_config *)calloc(hha_num, sizeof(struct uncore_config));
-    if (uncore_rx_ops_num == NULL) { // free uncore_rx_ops_num in function uncore_config_fini
-        free_namelist(hha_num, namelist);
+    names = (char (*)[UNCORE_NAME_SIZE])(list + max);
+
+    for (int i = 0; i < desc->evt_num; i++) {
+        const char *event = NULL;
+        int type = parse_template(desc->evt_list[i], &event);
+
+        if (type < 0) {
+            printf("%s: unknown uncore event %s\n", desc->name, desc->evt_list[i]);
+            continue;
+        }
+        for (int j = 0; j < unit_num; j++) {
+            if ((int)units[j].type != type || !unit_has_event(root, &units[j], event)) {
+                continue;
+            }
+            (void)snprintf_truncated_s(names[num], UNCORE_NAME_SIZE, "%s/%s/", units[j].name, event);
+            list[num] = names[num];
+            num++;
+        }
+    }
+    free(units);
+    if (num == 0) {
+        free(list);
         return -1;
     }
 
-    ret = hha_read_uncore_config(hha_num, namelist);
-    free_namelist(hha_num, namelist);
+    *evt_list = list;
+    *evt_num = num;
+    return 0;
+}
 
-    return ret;
+int uncore_get_events(const struct pmu_instance_desc *desc, char ***evt_list, int *evt_num)
+{
+    return expand_events(desc, false, evt_list, evt_num);
 }
 
-void uncore_config_fini(void)
+int uncore_get_events_by_name(const struct pmu_instance_desc *desc, char ***evt_list, int *evt_num)
 {
-#define UNCORE_CONFIG_FREE(uncore_event) do { \
-    if (uncore_event != NULL) { \
-        free(uncore_event); \
-        uncore_event = NULL; \
-    } \
-} while (0)
+    return expand_events(desc, true, evt_list, evt_num);
+}
 
-    UNCORE_CONFIG_FREE(uncore_rx_outer);
-    UNCORE_CONFIG_FREE(uncore_rx_sccl);
-    UNCORE_CONFIG_FREE(uncore_rx_ops_num);
+void uncore_put_events(char **evt_list)
+{
+    free(evt_list);
+}
+
+/* "<unit>/<event>/" as opened by uncore_get_events. */
+int uncore_parse_event(const char *evt, char *unit, size_t unit_size, const char **event)
+{
+    const char *slash = strchr(evt, '/');
+    size_t len;
+
+    if (slash == NULL || slash[1] == '\0') {
+        return -1;
+    }
+    len = (size_t)(slash - evt);
+    if (len >= unit_size) {
+        return -1;
+    }
+    (void)memcpy_s(unit, unit_size, evt, len);
+    unit[len] = '\0';
+    *event = slash + 1;
 
-    hha_num = 0;
+    return 0;
 }
@@ -12,31 +12,60 @@
 #ifndef __PMU_UNCORE_H__
 #define __PMU_UNCORE_H__
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define UNCORE_NAME_SIZE   256
 #define MAX_PATH_LEN       256
-#define DEVICE_PATH        "/sys/devices/"
+#define DEVICE_PATH        "/sys/devices"
+/* Prefixes every sysfs path, so discovery can run against a copied or made up tree. */
+#define UNCORE_SYSFS_ROOT_ENV "PMU_PLUGIN_SYSFS_ROOT"
 
-struct uncore_config {
-    char uncore_name[UNCORE_NAME_SIZE];
+enum uncore_unit_type {
+    UNCORE_HHA,
+    UNCORE_DDRC,
+    UNCORE_L3C,
+    UNCORE_PA,
+    UNCORE_UNIT_MAX,
 };
 
-enum uncore_type {
-    RX_OUTER,
-    RX_SCCL,
-    RX_OPS_NUM,
-    UNCORE_MAX,
+/* One uncore pmu, such as /sys/devices/hisi_sccl1_hha2. */
+struct uncore_unit {
+    char name[UNCORE_NAME_SIZE];
+    enum uncore_unit_type type;
+    /* The sccl, or sicl for io dies, and the unit number in it, from the name. */
+    int sccl;
+    int index;
+    /* The cpu counting for the unit and where it is, -1 if unknown. */
+    int cpu;
+    int socket;
+    int node;
 };
 
-int get_uncore_hha_num(void);
-struct uncore_config *get_rx_outer(void);
-struct uncore_config *get_rx_sccl(void);
-struct uncore_config *get_rx_ops_num(void);
-int hha_uncore_config_init(void);
-void uncore_config_fini(void);
+struct pmu_instance_desc;
+
+const char *uncore_type_name(enum uncore_unit_type type);
+/* UNCORE_SYSFS_ROOT_ENV, or "" for the live system. */
+const char *uncore_sysfs_root(void);
+/* Finds the units of every type under root, "" for the live system, sorted by type, sccl and
+ * index. Returns the unit count, *units is released with free.
+ */
+int uncore_discover(const char *root, struct uncore_unit **units);
+/* pmu_instance_desc get_events: expands each "<type>/<event>" of desc->evt_list, such as
+ * "hha/rx_outer", to that event of every unit of the type that has it.
+ * The list is released with uncore_put_events.
+ */
+int uncore_get_events(const struct pmu_instance_desc *desc, char ***evt_list, int *evt_num);
+/* As uncore_get_events, but the units of each event in the byte order of their names, as
+ * pmu_uncore_counting has always listed them: hisi_sccl11_hha0, hisi_sccl1_hha0, hisi_sccl3_hha0.
+ */
+int uncore_get_events_by_name(const struct pmu_instance_desc *desc, char ***evt_list, int *evt_num);
+void uncore_put_events(char **evt_list);
+/* Splits an opened event name into the unit name and the event, which keeps a trailing '/'. */
+int uncore_parse_event(const char *evt, char *unit, size_t unit_size, const char **event);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,221 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+/*
+ * Runs the uncore discovery against a sysfs tree made up under a temporary
+ * directory: two sockets with two sccls each, one node per sccl, and units of
+ * every type plus pmus that are no uncore unit.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pmu_engine.h"
+#include "pmu_uncore.h"
+
+#define TEST_PATH_LEN 512
+
+static char root[TEST_PATH_LEN];
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+/* Creates the parent directories of root + path and writes content to it, if any. */
+static void make_path(const char *path, const char *content)
+{
+    char full[TEST_PATH_LEN];
+    FILE *file;
+
+    (void)snprintf(full, sizeof(full), "%s%s", root, path);
+    for (char *p = full + strlen(root) + 1; *p != '\0'; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            (void)mkdir(full, 0755);
+            *p = '/';
+        }
+    }
+    if (content == NULL) {
+        (void)mkdir(full, 0755);
+        return;
+    }
+    file = fopen(full, "w");
+    if (file != NULL) {
+        fputs(content, file);
+        fclose(file);
+    }
+}
+
+static void add_unit(const char *name, int cpu, const char *const *events)
+{
+    char path[TEST_PATH_LEN];
+    char mask[32];
+
+    (void)snprintf(mask, sizeof(mask), "%d\n", cpu);
+    (void)snprintf(path, sizeof(path), "/sys/devices/%s/cpumask", name);
+    make_path(path, mask);
+    for (int i = 0; events != NULL && events[i] != NULL; i++) {
+        (void)snprintf(path, sizeof(path), "/sys/devices/%s/events/%s", name, events[i]);
+        make_path(path, "config=0x0\n");
+    }
+}
+
+static void add_cpu(int cpu, int socket, int node)
+{
+    char path[TEST_PATH_LEN];
+    char id[32];
+
+    (void)snprintf(id, sizeof(id), "%d\n", socket);
+    (void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    make_path(path, id);
+    (void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpu%d", node, cpu);
+    make_path(path, NULL);
+}
+
+static void build_tree(void)
+{
+    static const char *const hha_events[] = {"rx_outer", "rx_sccl", "rx_ops_num", NULL};
+    static const char *const ddrc_events[] = {"flux_rd", "flux_wr", NULL};
+    static const char *const l3c_events[] = {"rd_cpipe", "rd_hit_cpipe", NULL};
+    static const int sccls[] = {1, 3, 9, 11};
+    char name[64];
+
+    for (int i = 0; i < 4; i++) {
+        int cpu = i * 24;
+
+        add_cpu(cpu, i / 2, i);
+        for (int j = 0; j < 2; j++) {
+            (void)snprintf(name, sizeof(name), "hisi_sccl%d_hha%d", sccls[i], j);
+            add_unit(name, cpu, hha_events);
+            (void)snprintf(name, sizeof(name), "hisi_sccl%d_ddrc%d_0", sccls[i], j);
+            add_unit(name, cpu, ddrc_events);
+        }
+        (void)snprintf(name, sizeof(name), "hisi_sccl%d_l3c%d", sccls[i], sccls[i] * 2);
+        add_unit(name, cpu, l3c_events);
+    }
+    // An io die pa without an events dir, which is then taken to have every event.
+    add_unit("hisi_sicl0_pa0", 0, NULL);
+    // Pmus that are no known uncore unit.
+    add_unit("hisi_sccl1_sllc0", 0, NULL);
+    add_unit("armv8_pmuv3_0", 0, NULL);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+static void test_discover(void)
+{
+    struct uncore_unit *units = NULL;
+    int counts[UNCORE_UNIT_MAX] = {0};
+    int num = uncore_discover(root, &units);
+
+    CHECK(num == 21);
+    for (int i = 0; i < num; i++) {
+        counts[units[i].type]++;
+        if (i > 0) {
+            CHECK(units[i - 1].type < units[i].type || (units[i - 1].type == units[i].type &&
+                (units[i - 1].sccl < units[i].sccl || (units[i - 1].sccl == units[i].sccl &&
+                units[i - 1].index < units[i].index))));
+        }
+    }
+    CHECK(counts[UNCORE_HHA] == 8);
+    CHECK(counts[UNCORE_DDRC] == 8);
+    CHECK(counts[UNCORE_L3C] == 4);
+    CHECK(counts[UNCORE_PA] == 1);
+
+    if (num > 0) {
+        // hisi_sccl9_hha1: third sccl, counted on cpu 48 of socket 1, node 2.
+        CHECK(strcmp(units[5].name, "hisi_sccl9_hha1") == 0);
+        CHECK(units[5].sccl == 9 && units[5].index == 1);
+        CHECK(units[5].cpu == 48 && units[5].socket == 1 && units[5].node == 2);
+        CHECK(strcmp(units[num - 1].name, "hisi_sicl0_pa0") == 0);
+        CHECK(units[num - 1].socket == 0 && units[num - 1].node == 0);
+    }
+    free(units);
+}
+
+static void test_get_events(void)
+{
+    struct pmu_instance_desc desc = {
+        .name = "uncore_test",
+        .evt_list = {"hha/rx_sccl", "ddrc/flux_rd", "l3c/wr_cpipe", "pa/rx_req", "bogus/x"},
+        .evt_num = 5,
+    };
+    char unit[UNCORE_NAME_SIZE];
+    const char *event = NULL;
+    char **list = NULL;
+    int num = 0;
+
+    CHECK(setenv(UNCORE_SYSFS_ROOT_ENV, root, 1) == 0);
+    CHECK(strcmp(uncore_sysfs_root(), root) == 0);
+    // l3c/wr_cpipe is listed by no unit and bogus is no unit type.
+    CHECK(uncore_get_events(&desc, &list, &num) == 0);
+    CHECK(num == 8 + 8 + 1);
+    if (num == 17) {
+        CHECK(strcmp(list[0], "hisi_sccl1_hha0/rx_sccl/") == 0);
+        CHECK(strcmp(list[15], "hisi_sccl11_ddrc1_0/flux_rd/") == 0);
+        CHECK(strcmp(list[16], "hisi_sicl0_pa0/rx_req/") == 0);
+        CHECK(uncore_parse_event(list[15], unit, sizeof(unit), &event) == 0);
+        CHECK(strcmp(unit, "hisi_sccl11_ddrc1_0") == 0 && strcmp(event, "flux_rd/") == 0);
+    }
+    uncore_put_events(list);
+
+    // The layout pmu_uncore_counting has always had, byte order of the names: '1' sorts
+    // before '_', so sccl11 comes before sccl1, and both before sccl3.
+    desc.evt_list[0] = "hha/rx_outer";
+    desc.evt_num = 1;
+    CHECK(uncore_get_events_by_name(&desc, &list, &num) == 0);
+    CHECK(num == 8);
+    if (num == 8) {
+        CHECK(strcmp(list[0], "hisi_sccl11_hha0/rx_outer/") == 0);
+        CHECK(strcmp(list[2], "hisi_sccl1_hha0/rx_outer/") == 0);
+        CHECK(strcmp(list[4], "hisi_sccl3_hha0/rx_outer/") == 0);
+        CHECK(strcmp(list[7], "hisi_sccl9_hha1/rx_outer/") == 0);
+    }
+    uncore_put_events(list);
+
+    desc.evt_list[0] = "l3c/wr_cpipe";
+    desc.evt_num = 1;
+    CHECK(uncore_get_events(&desc, &list, &num) != 0);
+}
+
+int main(void)
+{
+    (void)snprintf(root, sizeof(root), "/tmp/uncore_sysfs_XXXXXX");
+    if (mkdtemp(root) == NULL) {
+        printf("mkdtemp failed\n");
+        return 1;
+    }
+    build_tree();
+
+    test_discover();
+    test_get_events();
+
+    (void)nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("uncore discovery passed\n");
+    return 0;
+}
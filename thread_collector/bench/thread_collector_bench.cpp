@@ -0,0 +1,326 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+/* Measures thread_collector run() against a synthetic /proc tree:
+ *   thread_collector_bench [-p procs] [-t threads per proc] [-c churn] [-n cycles] [-s]
+ * churn is the fraction of processes that replace one thread per cycle, -s also runs
+ * thread_sched_collector. Syscalls and allocations made during run() are counted by
+ * interposing the libc entry points below.
+ */
+#include "interface.h"
+#include "thread_info.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" int get_instance(Interface **ins);
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> syscalls(0);
+static std::atomic<uint64_t> allocations(0);
+
+static inline void count_syscall() {
+    if (counting.load(std::memory_order_relaxed)) {
+        syscalls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static inline void count_allocation() {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template <typename Fn>
+static Fn next_symbol(const char *name) {
+    return (Fn)dlsym(RTLD_NEXT, name);
+}
+
+extern "C" {
+void *malloc(size_t size) {
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    count_allocation();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    count_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+int openat(int dir_fd, const char *path, int flags, ...) {
+    static auto real = next_symbol<int (*)(int, const char*, int, ...)>("openat");
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    count_syscall();
+    return real(dir_fd, path, flags, mode);
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+    static auto real = next_symbol<ssize_t (*)(int, void*, size_t)>("read");
+    count_syscall();
+    return real(fd, buf, count);
+}
+
+int close(int fd) {
+    static auto real = next_symbol<int (*)(int)>("close");
+    count_syscall();
+    return real(fd);
+}
+
+off_t lseek(int fd, off_t offset, int whence) {
+    static auto real = next_symbol<off_t (*)(int, off_t, int)>("lseek");
+    count_syscall();
+    return real(fd, offset, whence);
+}
+
+long syscall(long number, ...) {
+    static auto real = next_symbol<long (*)(long, ...)>("syscall");
+    va_list ap;
+    long a[6];
+    va_start(ap, number);
+    for (int i = 0; i < 6; ++i) {
+        a[i] = va_arg(ap, long);
+    }
+    va_end(ap);
+    count_syscall();
+    return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+}
+
+struct BenchOptions {
+    int procs = 1000;
+    int threads = 20;
+    double churn = 0.01;
+    int cycles = 100;
+    bool sched = false;
+};
+
+struct FakeProc {
+    int pid;
+    std::vector<int> tids;
+};
+
+static std::string root;
+static int next_id = 1000;
+
+static void write_file(const std::string &path, const std::string &content) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path.c_str());
+        exit(1);
+    }
+    if (write(fd, content.data(), content.size()) != (ssize_t)content.size()) {
+        perror(path.c_str());
+        exit(1);
+    }
+    close(fd);
+}
+
+static std::string stat_line(int id, const std::string &comm, int num_threads) {
+    std::string stat = std::to_string(id) + " (" + comm + ") S 1";
+    for (int field = 5; field <= 52; ++field) {
+        stat += field == 14 ? " 100" : field == 20 ? " " + std::to_string(num_threads) : field == 22 ? " 1" : " 0";
+    }
+    return stat + "\n";
+}
+
+static std::string task_dir(int pid, int tid) {
+    return root + "/" + std::to_string(pid) + "/task/" + std::to_string(tid);
+}
+
+static void add_fake_thread(FakeProc &proc) {
+    int tid = proc.tids.empty() ? proc.pid : next_id++;
+    std::string dir = task_dir(proc.pid, tid);
+    std::string comm = "worker-" + std::to_string(tid % 1000);
+    mkdir(dir.c_str(), 0755);
+    write_file(dir + "/comm", comm + "\n");
+    write_file(dir + "/stat", stat_line(tid, comm, 1));
+    write_file(dir + "/schedstat", "1000000 2000 3\n");
+    write_file(dir + "/status", "Name:\t" + comm + "\nTgid:\t" + std::to_string(proc.pid) +
+        "\nvoluntary_ctxt_switches:\t10\nnonvoluntary_ctxt_switches:\t2\n");
+    proc.tids.push_back(tid);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+static void remove_fake_thread(FakeProc &proc, size_t i) {
+    nftw(task_dir(proc.pid, proc.tids[i]).c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    proc.tids.erase(proc.tids.begin() + i);
+}
+
+static std::vector<FakeProc> build_tree(const BenchOptions &opt) {
+    std::vector<FakeProc> procs(opt.procs);
+    for (auto &proc : procs) {
+        proc.pid = next_id++;
+        std::string dir = root + "/" + std::to_string(proc.pid);
+        mkdir(dir.c_str(), 0755);
+        mkdir((dir + "/task").c_str(), 0755);
+        write_file(dir + "/comm", "proc-" + std::to_string(proc.pid % 1000) + "\n");
+        for (int i = 0; i < opt.threads; ++i) {
+            add_fake_thread(proc);
+        }
+        write_file(dir + "/stat", stat_line(proc.pid, "proc", opt.threads));
+    }
+    return procs;
+}
+
+static void churn(std::vector<FakeProc> &procs, const BenchOptions &opt, std::mt19937 &rng) {
+    int n = (int)(procs.size() * opt.churn);
+    for (int i = 0; i < n; ++i) {
+        FakeProc &proc = procs[rng() % procs.size()];
+        /* Keep the leader, replace one of the other threads. */
+        if (proc.tids.size() > 1) {
+            remove_fake_thread(proc, 1 + rng() % (proc.tids.size() - 1));
+        }
+        add_fake_thread(proc);
+    }
+}
+
+static double percentile(std::vector<double> v, double p) {
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+static bool parse_options(int argc, char **argv, BenchOptions &opt) {
+    int c;
+    while ((c = getopt(argc, argv, "p:t:c:n:s")) != -1) {
+        switch (c) {
+            case 'p':
+                opt.procs = atoi(optarg);
+                break;
+            case 't':
+                opt.threads = atoi(optarg);
+                break;
+            case 'c':
+                opt.churn = atof(optarg);
+                break;
+            case 'n':
+                opt.cycles = atoi(optarg);
+                break;
+            case 's':
+                opt.sched = true;
+                break;
+            default:
+                return false;
+        }
+    }
+    return opt.procs > 0 && opt.threads > 0 && opt.cycles > 0 && opt.churn >= 0;
+}
+
+static Interface *find_instance(Interface *ins, int n, const char *name) {
+    for (int i = 0; i < n; ++i) {
+        if (strcmp(ins[i].get_name(), name) == 0) {
+            return &ins[i];
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    if (!parse_options(argc, argv, opt)) {
+        fprintf(stderr, "usage: %s [-p procs] [-t threads] [-c churn] [-n cycles] [-s]\n", argv[0]);
+        return 1;
+    }
+    char tmpl[] = "/tmp/thread_collector_bench.XXXXXX";
+    if (mkdtemp(tmpl) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    root = tmpl;
+    std::mt19937 rng(1);
+    std::vector<FakeProc> procs = build_tree(opt);
+    setenv("THREAD_COLLECTOR_PROC_ROOT", root.c_str(), 1);
+
+    Interface *ins = nullptr;
+    int n = get_instance(&ins);
+    Interface *collector = find_instance(ins, n, "thread_collector");
+    Interface *sched = opt.sched ? find_instance(ins, n, "thread_sched_collector") : nullptr;
+    if (collector == nullptr || !collector->enable() || (sched != nullptr && !sched->enable())) {
+        fprintf(stderr, "failed to enable thread_collector\n");
+        return 1;
+    }
+    Param param = {nullptr, 0};
+    std::vector<double> latency;
+    uint64_t total_syscalls = 0;
+    uint64_t total_allocations = 0;
+    for (int cycle = 0; cycle <= opt.cycles; ++cycle) {
+        if (cycle > 0) {
+            churn(procs, opt, rng);
+        }
+        struct timespec begin, end;
+        syscalls = 0;
+        allocations = 0;
+        counting = true;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        collector->run(&param);
+        if (sched != nullptr) {
+            sched->run(&param);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        counting = false;
+        /* The first cycle is the startup scan, report it apart. */
+        double us = (end.tv_sec - begin.tv_sec) * 1e6 + (end.tv_nsec - begin.tv_nsec) / 1e3;
+        if (cycle == 0) {
+            printf("startup scan: %.1f us, %lu syscalls, %lu allocations\n", us,
+                (unsigned long)syscalls.load(), (unsigned long)allocations.load());
+            continue;
+        }
+        latency.push_back(us);
+        total_syscalls += syscalls;
+        total_allocations += allocations;
+    }
+    const DataRingBuf *ring = collector->get_ring_buf();
+    printf("procs %d, threads %d, churn %.3f, cycles %d, published threads %d\n", opt.procs,
+        opt.procs * opt.threads, opt.churn, opt.cycles, ring->buf[ring->index].len);
+    printf("run() latency us: p50 %.1f p90 %.1f p99 %.1f max %.1f\n", percentile(latency, 0.5),
+        percentile(latency, 0.9), percentile(latency, 0.99), percentile(latency, 1.0));
+    printf("per cycle: %.1f syscalls, %.1f allocations\n", (double)total_syscalls / opt.cycles,
+        (double)total_allocations / opt.cycles);
+
+    if (sched != nullptr) {
+        sched->disable();
+    }
+    collector->disable();
+    nftw(root.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "collector_config.h"
+#include <cstdlib>
+#include <cstring>
+
+const int MAX_SCAN_WORKERS = 64;
+const int DEFAULT_IO_TIMEOUT_MS = 100;
+const int MAX_IO_TIMEOUT_MS = 10000;
+
+static CollectorConfig config;
+
+static int get_env_int(const char *name, int def, int min, int max) {
+    const char *value = getenv(name);
+    if (value == nullptr || *value == '\0') {
+        return def;
+    }
+    char *end = nullptr;
+    long n = strtol(value, &end, 10);
+    if (*end != '\0' || n < min || n > max) {
+        return def;
+    }
+    return (int)n;
+}
+
+static std::vector<std::string> get_env_list(const char *name, char sep) {
+    std::vector<std::string> items;
+    const char *value = getenv(name);
+    if (value == nullptr) {
+        return items;
+    }
+    const char *p = value;
+    for (;;) {
+        const char *end = strchr(p, sep);
+        size_t len = end == nullptr ? strlen(p) : (size_t)(end - p);
+        if (len > 0) {
+            items.emplace_back(p, len);
+        }
+        if (end == nullptr) {
+            break;
+        }
+        p = end + 1;
+    }
+    return items;
+}
+
+void load_collector_config() {
+    const char *root = getenv("THREAD_COLLECTOR_PROC_ROOT");
+    config.proc_root = root == nullptr || *root == '\0' ? "/proc" : root;
+    config.scan_workers = get_env_int("THREAD_COLLECTOR_SCAN_WORKERS", 1, 1, MAX_SCAN_WORKERS);
+    config.io_uring = get_env_int("THREAD_COLLECTOR_IO_URING", 1, 0, 1) != 0;
+    config.io_timeout_ms = get_env_int("THREAD_COLLECTOR_IO_TIMEOUT_MS", DEFAULT_IO_TIMEOUT_MS, 1, MAX_IO_TIMEOUT_MS);
+    config.scope_cgroups = get_env_list("THREAD_COLLECTOR_CGROUPS", ':');
+    config.scope_pids.clear();
+    for (auto &item : get_env_list("THREAD_COLLECTOR_PIDS", ',')) {
+        char *end = nullptr;
+        long pid = strtol(item.c_str(), &end, 10);
+        if (*end == '\0' && pid > 0) {
+            config.scope_pids.push_back((int)pid);
+        }
+    }
+    const char *comm = getenv("THREAD_COLLECTOR_COMM");
+    config.scope_comm = comm == nullptr ? "" : comm;
+}
+
+const CollectorConfig &get_collector_config() {
+    return config;
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef COLLECTOR_CONFIG_H
+#define COLLECTOR_CONFIG_H
+#include <string>
+#include <vector>
+
+/* Settings of thread_collector, read from the environment of the daemon when the
+ * instance is enabled, e.g. Environment= in its systemd unit.
+ */
+struct CollectorConfig {
+    /* THREAD_COLLECTOR_PROC_ROOT: procfs to walk, a fake tree for benchmarks. The proc
+     * connector is only used with the real /proc.
+     */
+    std::string proc_root;
+    /* THREAD_COLLECTOR_SCAN_WORKERS: threads sharing a /proc walk, 1 walks serially. */
+    int scan_workers;
+    /* THREAD_COLLECTOR_IO_URING: 0 reads /proc files with plain syscalls, otherwise they
+     * are batched through io_uring where the kernel supports it.
+     * THREAD_COLLECTOR_IO_TIMEOUT_MS: how long a batched read may take before the file is
+     * skipped for the cycle, e.g. for a task hung in D state.
+     */
+    bool io_uring;
+    int io_timeout_ms;
+    /* Scope of the collection. A process is walked if it matches any of them, and the
+     * whole /proc is walked if none is set.
+     * THREAD_COLLECTOR_CGROUPS: ':' separated cgroup v2 paths, relative to /sys/fs/cgroup.
+     * THREAD_COLLECTOR_PIDS: ',' separated pids.
+     * THREAD_COLLECTOR_COMM: extended regex searched in the comm of the process.
+     */
+    std::vector<std::string> scope_cgroups;
+    std::vector<int> scope_pids;
+    std::string scope_comm;
+};
+
+void load_collector_config();
+const CollectorConfig &get_collector_config();
+
+#endif // !COLLECTOR_CONFIG_H
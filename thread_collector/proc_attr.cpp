@@ -0,0 +1,299 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "interface.h"
+#include "thread_info.h"
+#include "thread_collector.h"
+#include "proc_fs.h"
+#include "proc_batch.h"
+#include "snapshot_ring.h"
+#include "collector_config.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+char proc_attr_name[] = "thread_collector_proc";
+const int PROC_ATTR_CYCLE_SIZE = 1000;
+const int ATTR_STAT_BUF_SIZE = 1024;
+const int ATTR_CGROUP_BUF_SIZE = 4096;
+const int ATTR_STATUS_BUF_SIZE = 8192;
+/* Processes whose attribute files are read in one batch. */
+const int ATTR_BATCH = 16;
+enum AttrFile {
+    ATTR_FILE_STAT,
+    ATTR_FILE_CMDLINE,
+    ATTR_FILE_CGROUP,
+    ATTR_FILE_STATUS,
+    ATTR_FILE_NUM,
+};
+
+static bool attr_enabled = false;
+static SnapshotRing<ProcessInfo> attr_ring_buf;
+/* The cache, filled on first sight and dropped on exec, pid reuse or exit. */
+static std::vector<ProcessInfo> attrs;
+/* key: pid, value: the index of attrs. */
+static IdIndex attr_index;
+/* Processes seen in the table but not cached yet. */
+static std::vector<int> new_pids;
+static IdIndex new_index;
+static ProcBatchReader attr_reader;
+static ProcReadReq attr_reqs[ATTR_BATCH * ATTR_FILE_NUM];
+static char attr_bufs[ATTR_BATCH][ATTR_STAT_BUF_SIZE + PROCESS_CMDLINE_LEN + ATTR_CGROUP_BUF_SIZE +
+    ATTR_STATUS_BUF_SIZE];
+
+static void remove_attr(int slot) {
+    attr_index.erase(attrs[slot].pid);
+    if (slot != (int)attrs.size() - 1) {
+        attrs[slot] = attrs.back();
+        attr_index.set(attrs[slot].pid, slot);
+    }
+    attrs.pop_back();
+}
+
+void proc_attr_invalidate(int pid) {
+    if (!attr_enabled) {
+        return;
+    }
+    int slot = attr_index.find(pid);
+    if (slot >= 0) {
+        remove_attr(slot);
+    }
+}
+
+static void prepare_reads(int pid, char *buf, ProcReadReq *reqs) {
+    static const char *const files[ATTR_FILE_NUM] = {"stat", "cmdline", "cgroup", "status"};
+    static const size_t sizes[ATTR_FILE_NUM] = {
+        ATTR_STAT_BUF_SIZE, PROCESS_CMDLINE_LEN, ATTR_CGROUP_BUF_SIZE, ATTR_STATUS_BUF_SIZE
+    };
+    for (int i = 0; i < ATTR_FILE_NUM; ++i) {
+        reqs[i].path = ProcPath();
+        reqs[i].path.add(pid).add("/").add(files[i]);
+        reqs[i].buf = buf;
+        reqs[i].size = sizes[i];
+        buf += sizes[i];
+    }
+}
+
+static void parse_cmdline(const ProcReadReq &req, char *out) {
+    size_t n = req.len > 0 ? (size_t)req.len : 0;
+    /* The arguments are separated by NULs, keep the last one terminating the string. */
+    while (n > 0 && req.buf[n - 1] == '\0') {
+        n--;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = req.buf[i] == '\0' ? ' ' : req.buf[i];
+    }
+    out[n] = '\0';
+}
+
+/* Takes the "0::<path>" line of cgroup v2, or the first line on a v1 only system. */
+static void parse_cgroup(const ProcReadReq &req, char *out) {
+    out[0] = '\0';
+    if (req.len <= 0) {
+        return;
+    }
+    const char *line = req.buf;
+    const char *first = nullptr;
+    while (*line != '\0') {
+        const char *end = strchr(line, '\n');
+        size_t len = end == nullptr ? strlen(line) : (size_t)(end - line);
+        const char *path = (const char*)memchr(line, ':', len);
+        path = path == nullptr ? nullptr : (const char*)memchr(path + 1, ':', len - (path + 1 - line));
+        if (path != nullptr) {
+            path++;
+            if (first == nullptr) {
+                first = path;
+            }
+            if (strncmp(line, "0::", 3) == 0) {
+                first = path;
+                break;
+            }
+        }
+        if (end == nullptr) {
+            break;
+        }
+        line = end + 1;
+    }
+    if (first == nullptr) {
+        return;
+    }
+    size_t n = strcspn(first, "\n");
+    n = n < PROCESS_CGROUP_LEN - 1 ? n : PROCESS_CGROUP_LEN - 1;
+    memcpy(out, first, n);
+    out[n] = '\0';
+}
+
+/* Parses a node list such as "0-1,3" into a mask of the first 64 nodes. */
+static uint64_t parse_node_list(const char *p) {
+    uint64_t mask = 0;
+    while (*p >= '0' && *p <= '9') {
+        unsigned long first = strtoul(p, (char**)&p, 10);
+        unsigned long last = first;
+        if (*p == '-') {
+            last = strtoul(p + 1, (char**)&p, 10);
+        }
+        for (unsigned long n = first; n <= last && n < 64; ++n) {
+            mask |= 1ULL << n;
+        }
+        if (*p != ',') {
+            break;
+        }
+        p++;
+    }
+    return mask;
+}
+
+static bool parse_attrs(int pid, const ProcReadReq *reqs, ProcessInfo *info) {
+    const ProcReadReq &stat = reqs[ATTR_FILE_STAT];
+    uint64_t start_time = 0;
+    if (stat.len <= 0 || !proc_stat_field(stat.buf, stat.len, 22, &start_time)) {
+        return false;
+    }
+    memset(info, 0, sizeof(*info));
+    info->pid = pid;
+    info->start_time = start_time;
+    parse_cmdline(reqs[ATTR_FILE_CMDLINE], info->cmdline);
+    parse_cgroup(reqs[ATTR_FILE_CGROUP], info->cgroup);
+    const ProcReadReq &status = reqs[ATTR_FILE_STATUS];
+    const char *p = status.len > 0 ? strstr(status.buf, "\nMems_allowed_list:") : nullptr;
+    if (p != nullptr) {
+        p += strlen("\nMems_allowed_list:");
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        info->mems_allowed = parse_node_list(p);
+    }
+    return true;
+}
+
+static void fill_new_attrs(int proc_fd) {
+    for (size_t begin = 0; begin < new_pids.size(); begin += ATTR_BATCH) {
+        int n = new_pids.size() - begin < (size_t)ATTR_BATCH ? new_pids.size() - begin : ATTR_BATCH;
+        for (int j = 0; j < n; ++j) {
+            prepare_reads(new_pids[begin + j], attr_bufs[j], &attr_reqs[j * ATTR_FILE_NUM]);
+        }
+        attr_reader.read(proc_fd, attr_reqs, n * ATTR_FILE_NUM);
+        for (int j = 0; j < n; ++j) {
+            ProcessInfo info;
+            int pid = new_pids[begin + j];
+            /* Gone already, or stat timed out: try again next cycle. */
+            if (!parse_attrs(pid, &attr_reqs[j * ATTR_FILE_NUM], &info)) {
+                continue;
+            }
+            attr_index.set(pid, attrs.size());
+            attrs.push_back(info);
+        }
+    }
+}
+
+const char* proc_attr_get_name() {
+    return proc_attr_name;
+}
+
+const char* proc_attr_get_description() {
+    return "per-process cmdline, cgroup and memory node binding, cached for the process lifetime";
+}
+
+const char* proc_attr_get_dep() {
+    return "thread_collector";
+}
+
+int proc_attr_get_period() {
+    return PROC_ATTR_CYCLE_SIZE;
+}
+
+int proc_attr_get_priority() {
+    return 1;
+}
+
+bool proc_attr_enable() {
+    attrs.clear();
+    attr_index.clear();
+    attr_ring_buf.reset(proc_attr_name);
+    const CollectorConfig &config = get_collector_config();
+    if (config.io_uring) {
+        (void)attr_reader.init(config.io_timeout_ms, ATTR_STATUS_BUF_SIZE);
+    } else {
+        attr_reader.exit();
+    }
+    attr_enabled = true;
+    return true;
+}
+
+void proc_attr_disable() {
+    attr_enabled = false;
+    attrs.clear();
+    attr_index.clear();
+    attr_reader.exit();
+}
+
+const DataRingBuf* proc_attr_get_ring_buf() {
+    return attr_ring_buf.get();
+}
+
+void proc_attr_run(const Param *param) {
+    (void)param;
+    const ThreadTable &threads = get_thread_table();
+    int proc_fd = get_proc_fd();
+    if (proc_fd < 0) {
+        return;
+    }
+    /* thread_num doubles as the seen mark: processes left at 0 have exited. */
+    for (auto &attr : attrs) {
+        attr.thread_num = 0;
+    }
+    new_pids.clear();
+    new_index.clear();
+    for (int i = 0; i < threads.size(); ++i) {
+        int pid = threads.pid[i];
+        int slot = attr_index.find(pid);
+        if (slot >= 0) {
+            attrs[slot].thread_num++;
+        } else if (new_index.find(pid) < 0) {
+            new_index.set(pid, new_pids.size());
+            new_pids.push_back(pid);
+        }
+    }
+    for (int i = (int)attrs.size() - 1; i >= 0; --i) {
+        if (attrs[i].thread_num == 0) {
+            remove_attr(i);
+        }
+    }
+    int cached = attrs.size();
+    fill_new_attrs(proc_fd);
+    for (int i = 0; i < threads.size(); ++i) {
+        int slot = attr_index.find(threads.pid[i]);
+        if (slot >= cached) {
+            attrs[slot].thread_num++;
+        }
+    }
+    std::vector<ProcessInfo> &out = attr_ring_buf.next();
+    out = attrs;
+    std::sort(out.begin(), out.end(), [](const ProcessInfo &a, const ProcessInfo &b) {
+        return a.pid < b.pid;
+    });
+    attr_ring_buf.publish();
+}
+
+struct Interface thread_proc_collect = {
+    .get_version = get_version,
+    .get_name = proc_attr_get_name,
+    .get_description = proc_attr_get_description,
+    .get_dep = proc_attr_get_dep,
+    .get_priority = proc_attr_get_priority,
+    .get_type = nullptr,
+    .get_period = proc_attr_get_period,
+    .enable = proc_attr_enable,
+    .disable = proc_attr_disable,
+    .get_ring_buf = proc_attr_get_ring_buf,
+    .run = proc_attr_run,
+};
@@ -0,0 +1,420 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "proc_batch.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+/* Files in flight at a time. Each slot owns its buffer, so a hung read never writes
+ * into memory that was handed back to the caller.
+ */
+const int BATCH_SLOTS = 64;
+/* Per slot: open, read, close and a cancel. */
+const unsigned BATCH_ENTRIES = 256;
+
+enum BatchOp {
+    BATCH_OP_OPEN = 1,
+    BATCH_OP_READ,
+    BATCH_OP_CLOSE,
+    BATCH_OP_CANCEL,
+};
+
+static inline uint64_t make_user_data(int slot, BatchOp op) {
+    return ((uint64_t)slot << 8) | op;
+}
+
+static int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+ProcBatchReader::ProcBatchReader() : ring_fd(-1), timeout_ms(0), buf_size(0), sq_ptr(MAP_FAILED), sq_size(0),
+    cq_ptr(MAP_FAILED), cq_size(0), sqes((struct io_uring_sqe*)MAP_FAILED), sqes_size(0), sq_head(nullptr),
+    sq_tail(nullptr), sq_mask(nullptr), sq_array(nullptr), cq_head(nullptr), cq_tail(nullptr), cq_mask(nullptr),
+    cqes(nullptr), to_submit(0), busy(0) {}
+
+ProcBatchReader::~ProcBatchReader() {
+    exit();
+}
+
+bool ProcBatchReader::init(int timeout, size_t size) {
+    exit();
+    timeout_ms = timeout;
+    buf_size = size;
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = uring_setup(BATCH_ENTRIES, &p);
+    if (fd < 0) {
+        return false;
+    }
+    ring_fd = fd;
+    /* The timed wait needs IORING_ENTER_EXT_ARG (5.11), which also brings every opcode used here. */
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        exit();
+        return false;
+    }
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+    }
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        exit();
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            exit();
+            return false;
+        }
+    }
+    sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = (struct io_uring_sqe*)mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        exit();
+        return false;
+    }
+    char *sq = (char*)sq_ptr;
+    char *cq = (char*)cq_ptr;
+    sq_head = (unsigned*)(sq + p.sq_off.head);
+    sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    sq_array = (unsigned*)(sq + p.sq_off.array);
+    cq_head = (unsigned*)(cq + p.cq_off.head);
+    cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    slots.resize(BATCH_SLOTS);
+    bufs.resize(BATCH_SLOTS * buf_size);
+    for (int i = 0; i < BATCH_SLOTS; ++i) {
+        slots[i].state = SLOT_FREE;
+        slots[i].stale = false;
+        slots[i].fd = -1;
+        slots[i].req = nullptr;
+        slots[i].buf = &bufs[i * buf_size];
+    }
+    to_submit = 0;
+    busy = 0;
+    return true;
+}
+
+void ProcBatchReader::exit() {
+    if (ring_fd >= 0 && !wait_idle(now_ns() + (int64_t)timeout_ms * 1000000)) {
+        /* A cancelled request blocked in the kernel, such as a read waiting for the mmap_lock
+         * of another process, still writes into its slot when it completes, even after the
+         * ring is closed. Its buffer and path are leaked rather than freed under it, and a
+         * slot fd may already be closed by its linked close, so a hung one is leaked too.
+         */
+        (void)new std::vector<Slot>(std::move(slots));
+        (void)new std::vector<char>(std::move(bufs));
+    }
+    for (auto &slot : slots) {
+        if (slot.state == SLOT_OPENED) {
+            close(slot.fd);
+        }
+    }
+    slots.clear();
+    bufs.clear();
+    if (sqes != MAP_FAILED) {
+        munmap(sqes, sqes_size);
+        sqes = (struct io_uring_sqe*)MAP_FAILED;
+    }
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+        munmap(cq_ptr, cq_size);
+    }
+    cq_ptr = MAP_FAILED;
+    if (sq_ptr != MAP_FAILED) {
+        munmap(sq_ptr, sq_size);
+        sq_ptr = MAP_FAILED;
+    }
+    if (ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+struct io_uring_sqe *ProcBatchReader::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail;
+    if (tail - head > *sq_mask) {
+        return nullptr;
+    }
+    unsigned index = tail & *sq_mask;
+    struct io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    to_submit++;
+    return sqe;
+}
+
+void ProcBatchReader::complete(uint64_t user_data, int res) {
+    BatchOp op = (BatchOp)(user_data & 0xff);
+    if (op == BATCH_OP_CANCEL) {
+        return;
+    }
+    Slot &slot = slots[user_data >> 8];
+    switch (op) {
+        case BATCH_OP_OPEN:
+            if (slot.stale) {
+                /* Opened after its batch gave up on it. */
+                if (res >= 0) {
+                    close(res);
+                }
+                slot.stale = false;
+                slot.state = SLOT_FREE;
+                break;
+            }
+            busy--;
+            if (res < 0) {
+                slot.state = SLOT_FREE;
+                break;
+            }
+            slot.fd = res;
+            slot.state = SLOT_OPENED;
+            break;
+        case BATCH_OP_READ:
+            if (!slot.stale && res >= 0) {
+                memcpy(slot.req->buf, slot.buf, res);
+                slot.req->buf[res] = '\0';
+                slot.req->len = res;
+            }
+            slot.state = SLOT_CLOSE;
+            break;
+        case BATCH_OP_CLOSE:
+            /* A failed or cancelled read cancels the linked close. */
+            if (res < 0) {
+                close(slot.fd);
+            }
+            slot.fd = -1;
+            if (!slot.stale) {
+                busy--;
+            }
+            slot.stale = false;
+            slot.state = SLOT_FREE;
+            break;
+        default:
+            break;
+    }
+}
+
+void ProcBatchReader::reap() {
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+        complete(cqe->user_data, cqe->res);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* Submits the queued operations and waits until the batch has nothing in flight or the
+ * deadline passes. Returns false on timeout.
+ */
+bool ProcBatchReader::submit_and_wait(int64_t deadline) {
+    for (;;) {
+        reap();
+        if (busy == 0 && to_submit == 0) {
+            return true;
+        }
+        int64_t left = deadline - now_ns();
+        if (left <= 0) {
+            return false;
+        }
+        struct __kernel_timespec ts = {left / 1000000000, left % 1000000000};
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        unsigned flags = IORING_ENTER_EXT_ARG | (busy > 0 ? IORING_ENTER_GETEVENTS : 0);
+        int ret = uring_enter(ring_fd, to_submit, busy > 0 ? 1 : 0, flags, &arg, sizeof(arg));
+        if (ret >= 0) {
+            to_submit -= ret < (int)to_submit ? ret : to_submit;
+        } else if (errno != ETIME && errno != EINTR && errno != EBUSY) {
+            return false;
+        }
+    }
+}
+
+/* Waits until no slot has an operation in flight, including those of expired batches.
+ * Returns false on timeout.
+ */
+bool ProcBatchReader::wait_idle(int64_t deadline) {
+    for (;;) {
+        reap();
+        bool idle = true;
+        for (auto &slot : slots) {
+            if (slot.state != SLOT_FREE && slot.state != SLOT_OPENED) {
+                idle = false;
+                break;
+            }
+        }
+        if (idle) {
+            return true;
+        }
+        int64_t left = deadline - now_ns();
+        if (left <= 0) {
+            return false;
+        }
+        struct __kernel_timespec ts = {left / 1000000000, left % 1000000000};
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        int ret = uring_enter(ring_fd, to_submit, 1, IORING_ENTER_EXT_ARG | IORING_ENTER_GETEVENTS, &arg, sizeof(arg));
+        if (ret >= 0) {
+            to_submit -= ret < (int)to_submit ? ret : to_submit;
+        } else if (errno != ETIME && errno != EINTR && errno != EBUSY) {
+            return false;
+        }
+    }
+}
+
+/* Gives up on what is still in flight in the batch. */
+void ProcBatchReader::expire() {
+    for (int i = 0; i < (int)slots.size(); ++i) {
+        Slot &slot = slots[i];
+        if (slot.stale || (slot.state != SLOT_OPEN && slot.state != SLOT_READ && slot.state != SLOT_CLOSE)) {
+            continue;
+        }
+        slot.stale = true;
+        busy--;
+        /* Read in time, only the close is left. */
+        if (slot.state == SLOT_CLOSE) {
+            continue;
+        }
+        slot.req->len = -1;
+        struct io_uring_sqe *sqe = get_sqe();
+        if (sqe == nullptr) {
+            continue;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = make_user_data(i, slot.state == SLOT_OPEN ? BATCH_OP_OPEN : BATCH_OP_READ);
+        sqe->user_data = make_user_data(i, BATCH_OP_CANCEL);
+    }
+    /* Hand the cancels to the kernel without waiting for them. */
+    if (to_submit > 0) {
+        int ret = uring_enter(ring_fd, to_submit, 0, 0, nullptr, 0);
+        if (ret > 0) {
+            to_submit -= ret < (int)to_submit ? ret : to_submit;
+        }
+    }
+}
+
+void ProcBatchReader::read_chunk(int dir_fd, ProcReadReq *reqs, int n) {
+    int64_t deadline = now_ns() + (int64_t)timeout_ms * 1000000;
+    int k = 0;
+    for (int i = 0; i < (int)slots.size() && k < n; ++i) {
+        Slot &slot = slots[i];
+        if (slot.state != SLOT_FREE) {
+            continue;
+        }
+        struct io_uring_sqe *sqe = get_sqe();
+        if (sqe == nullptr) {
+            break;
+        }
+        slot.req = &reqs[k++];
+        slot.path = slot.req->path;
+        slot.state = SLOT_OPEN;
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = dir_fd;
+        sqe->addr = (uint64_t)(uintptr_t)slot.path.c_str();
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        sqe->user_data = make_user_data(i, BATCH_OP_OPEN);
+        busy++;
+    }
+    if (!submit_and_wait(deadline)) {
+        expire();
+    }
+    for (int i = 0; i < (int)slots.size(); ++i) {
+        Slot &slot = slots[i];
+        if (slot.state != SLOT_OPENED) {
+            continue;
+        }
+        struct io_uring_sqe *read_sqe = get_sqe();
+        struct io_uring_sqe *close_sqe = read_sqe == nullptr ? nullptr : get_sqe();
+        if (close_sqe == nullptr) {
+            /* Cannot happen with BATCH_ENTRIES per slot, but never leak the file. */
+            close(slot.fd);
+            slot.fd = -1;
+            slot.state = SLOT_FREE;
+            continue;
+        }
+        size_t size = slot.req->size < buf_size ? slot.req->size : buf_size;
+        read_sqe->opcode = IORING_OP_READ;
+        read_sqe->fd = slot.fd;
+        read_sqe->addr = (uint64_t)(uintptr_t)slot.buf;
+        read_sqe->len = size - 1;
+        read_sqe->off = 0;
+        read_sqe->flags = IOSQE_IO_LINK;
+        read_sqe->user_data = make_user_data(i, BATCH_OP_READ);
+        close_sqe->opcode = IORING_OP_CLOSE;
+        close_sqe->fd = slot.fd;
+        close_sqe->user_data = make_user_data(i, BATCH_OP_CLOSE);
+        slot.state = SLOT_READ;
+        busy++;
+    }
+    /* The read phase gets its own timeout, as every request does. */
+    deadline = now_ns() + (int64_t)timeout_ms * 1000000;
+    if (!submit_and_wait(deadline)) {
+        expire();
+    }
+}
+
+void ProcBatchReader::read(int dir_fd, ProcReadReq *reqs, int n) {
+    for (int i = 0; i < n; ++i) {
+        reqs[i].len = -1;
+    }
+    if (ring_fd < 0) {
+        for (int i = 0; i < n; ++i) {
+            reqs[i].len = proc_read_at(dir_fd, reqs[i].path.c_str(), reqs[i].buf, reqs[i].size);
+        }
+        return;
+    }
+    /* Pick up requests of earlier batches that completed late. */
+    reap();
+    int done = 0;
+    while (done < n) {
+        int free_slots = 0;
+        for (auto &slot : slots) {
+            free_slots += slot.state == SLOT_FREE;
+        }
+        if (free_slots == 0) {
+            /* Every slot is held by a hung task, leave the rest unread. */
+            break;
+        }
+        int count = n - done < free_slots ? n - done : free_slots;
+        read_chunk(dir_fd, reqs + done, count);
+        done += count;
+    }
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef PROC_BATCH_H
+#define PROC_BATCH_H
+#include "proc_fs.h"
+#include <cstdint>
+#include <vector>
+
+/* One file of a batch. */
+struct ProcReadReq {
+    /* Relative to the dir fd of the batch. */
+    ProcPath path;
+    char *buf;
+    size_t size;
+    /* Set by the batch: the length read with buf NUL-terminated, or -1 if the file
+     * could not be read in time.
+     */
+    ssize_t len;
+};
+
+/* Reads many small /proc files with a few io_uring_enter calls instead of an
+ * open/read/close triple each. A batch takes one round trip for the opens and one for
+ * the reads, and every round trip waits at most timeout_ms, so a task stuck in D state
+ * costs its own request and not the cycle. Requests that time out are cancelled, but
+ * keep their slot until the kernel completes them.
+ * Not thread safe, use one reader per thread.
+ */
+class ProcBatchReader {
+public:
+    ProcBatchReader();
+    ~ProcBatchReader();
+    /* buf_size bounds the files read through the ring. Returns false if io_uring is not
+     * usable, then read() falls back to proc_read_at().
+     */
+    bool init(int timeout_ms, size_t buf_size);
+    /* Waits up to timeout_ms for the requests still in flight, and leaks the slots if one
+     * is still running in the kernel.
+     */
+    void exit();
+    bool uring() const { return ring_fd >= 0; }
+    void read(int dir_fd, ProcReadReq *reqs, int n);
+private:
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_OPEN,
+        SLOT_OPENED,
+        SLOT_READ,
+        SLOT_CLOSE,
+    };
+    struct Slot {
+        SlotState state;
+        /* Timed out in its batch, the completions are only reaped. */
+        bool stale;
+        int fd;
+        ProcReadReq *req;
+        ProcPath path;
+        char *buf;
+    };
+    struct io_uring_sqe *get_sqe();
+    bool submit_and_wait(int64_t deadline);
+    bool wait_idle(int64_t deadline);
+    void reap();
+    void complete(uint64_t user_data, int res);
+    void expire();
+    void read_chunk(int dir_fd, ProcReadReq *reqs, int n);
+
+    int ring_fd;
+    int timeout_ms;
+    size_t buf_size;
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned to_submit;
+    /* Slots of the current batch with an operation in flight. */
+    int busy;
+    std::vector<Slot> slots;
+    std::vector<char> bufs;
+};
+
+#endif // !PROC_BATCH_H
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "proc_connector.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+/* Large enough to absorb a fork storm between two cycles. */
+const int CONN_RCVBUF_SIZE = 8 * 1024 * 1024;
+/* Upper bound of messages handled in one call, the rest is left for the next cycle. */
+const int CONN_MAX_MSGS = 65536;
+
+static int send_mcast_op(int fd, enum proc_cn_mcast_op op) {
+    const size_t len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+    alignas(struct nlmsghdr) char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))];
+
+    memset(buf, 0, sizeof(buf));
+    struct nlmsghdr *nlh = (struct nlmsghdr*)buf;
+    nlh->nlmsg_len = len;
+    nlh->nlmsg_pid = 0;
+    nlh->nlmsg_type = NLMSG_DONE;
+    struct cn_msg *msg = (struct cn_msg*)NLMSG_DATA(nlh);
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->len = sizeof(op);
+    memcpy(msg->data, &op, sizeof(op));
+    return send(fd, buf, len, 0) < 0 ? -1 : 0;
+}
+
+int proc_connector_open() {
+    int fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd < 0) {
+        return -1;
+    }
+    int size = CONN_RCVBUF_SIZE;
+    /* SO_RCVBUFFORCE ignores rmem_max, fall back to the capped size if it is not permitted. */
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0) {
+        (void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    addr.nl_pid = 0;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || send_mcast_op(fd, PROC_CN_MCAST_LISTEN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void proc_connector_close(int fd) {
+    if (fd < 0) {
+        return;
+    }
+    (void)send_mcast_op(fd, PROC_CN_MCAST_IGNORE);
+    close(fd);
+}
+
+static void parse_event(const struct proc_event *ev, std::vector<ProcEvent> &events) {
+    ProcEvent e;
+    memset(&e, 0, sizeof(e));
+    switch (ev->what) {
+        case proc_event::PROC_EVENT_FORK:
+            e.type = PROC_CONN_FORK;
+            e.pid = ev->event_data.fork.child_pid;
+            e.tgid = ev->event_data.fork.child_tgid;
+            e.parent_pid = ev->event_data.fork.parent_pid;
+            break;
+        case proc_event::PROC_EVENT_EXEC:
+            e.type = PROC_CONN_EXEC;
+            e.pid = ev->event_data.exec.process_pid;
+            e.tgid = ev->event_data.exec.process_tgid;
+            break;
+        case proc_event::PROC_EVENT_COMM:
+            e.type = PROC_CONN_COMM;
+            e.pid = ev->event_data.comm.process_pid;
+            e.tgid = ev->event_data.comm.process_tgid;
+            memcpy(e.comm, ev->event_data.comm.comm, PROC_COMM_LEN);
+            e.comm[PROC_COMM_LEN - 1] = '\0';
+            break;
+        case proc_event::PROC_EVENT_EXIT:
+            e.type = PROC_CONN_EXIT;
+            e.pid = ev->event_data.exit.process_pid;
+            e.tgid = ev->event_data.exit.process_tgid;
+            break;
+        default:
+            return;
+    }
+    events.push_back(e);
+}
+
+int proc_connector_recv(int fd, std::vector<ProcEvent> &events) {
+    alignas(struct nlmsghdr) static char buf[8192];
+
+    for (int i = 0; i < CONN_MAX_MSGS; ++i) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            /* ENOBUFS: the socket overran and events were dropped. */
+            return -1;
+        }
+        for (struct nlmsghdr *nlh = (struct nlmsghdr*)buf; NLMSG_OK(nlh, (unsigned int)len); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_ERROR || nlh->nlmsg_type == NLMSG_NOOP) {
+                continue;
+            }
+            struct cn_msg *msg = (struct cn_msg*)NLMSG_DATA(nlh);
+            if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) {
+                continue;
+            }
+            parse_event((const struct proc_event*)msg->data, events);
+        }
+    }
+    return 0;
+}
+
+void proc_connector_drain(int fd) {
+    alignas(struct nlmsghdr) static char buf[8192];
+
+    for (int i = 0; i < CONN_MAX_MSGS; ++i) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        /* Another overrun only drops more of what is being thrown away. */
+        if (len < 0 && errno != EINTR && errno != ENOBUFS) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef PROC_CONNECTOR_H
+#define PROC_CONNECTOR_H
+#include <vector>
+
+const int PROC_COMM_LEN = 16;
+
+enum ProcEventType {
+    PROC_CONN_FORK,
+    PROC_CONN_EXEC,
+    PROC_CONN_COMM,
+    PROC_CONN_EXIT,
+};
+
+struct ProcEvent {
+    ProcEventType type;
+    /* The thread the event refers to. For fork, it is the new thread. */
+    int pid;
+    int tgid;
+    /* Only valid for fork. The parent of the process, which for a new thread is not the
+     * thread that created it.
+     */
+    int parent_pid;
+    /* Only valid for comm. */
+    char comm[PROC_COMM_LEN];
+};
+
+/* Subscribes to the netlink proc connector. Requires CAP_NET_ADMIN.
+ * The return value is the socket fd, or -1 if the connector is unavailable.
+ */
+int proc_connector_open();
+void proc_connector_close(int fd);
+/* Appends all pending events to events without blocking.
+ * The return value is -1 if events were lost, then the caller must rescan.
+ */
+int proc_connector_recv(int fd, std::vector<ProcEvent> &events);
+/* Throws away the events queued on the socket, which predate a rescan of /proc. */
+void proc_connector_drain(int fd);
+
+#endif // !PROC_CONNECTOR_H
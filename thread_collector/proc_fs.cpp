@@ -0,0 +1,176 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "proc_fs.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+
+ProcPath &ProcPath::add(int id) {
+    char tmp[16];
+    int n = 0;
+    unsigned int v = id < 0 ? 0 : id;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    while (n > 0 && len < PROC_PATH_MAX - 1) {
+        buf[len++] = tmp[--n];
+    }
+    buf[len] = '\0';
+    return *this;
+}
+
+ProcPath &ProcPath::add(const char *s) {
+    while (*s != '\0' && len < PROC_PATH_MAX - 1) {
+        buf[len++] = *s++;
+    }
+    buf[len] = '\0';
+    return *this;
+}
+
+int proc_parse_id(const char *name) {
+    int id = 0;
+    if (*name == '\0') {
+        return -1;
+    }
+    for (; *name != '\0'; ++name) {
+        if (*name < '0' || *name > '9') {
+            return -1;
+        }
+        id = id * 10 + (*name - '0');
+    }
+    return id;
+}
+
+int proc_open_dir(int dir_fd, const char *path) {
+    return openat(dir_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+ssize_t proc_read_at(int dir_fd, const char *path, char *buf, size_t size) {
+    int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t len;
+    do {
+        len = read(fd, buf, size - 1);
+    } while (len < 0 && errno == EINTR);
+    close(fd);
+    if (len < 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+bool proc_read_comm(int dir_fd, const char *path, char *name, size_t size) {
+    char buf[PROC_COMM_BUF_SIZE];
+    ssize_t len = proc_read_at(dir_fd, path, buf, sizeof(buf));
+    return proc_parse_comm(buf, len, name, size);
+}
+
+bool proc_parse_comm(char *buf, ssize_t len, char *name, size_t size) {
+    if (len <= 0) {
+        return false;
+    }
+    if (buf[len - 1] == '\n') {
+        buf[--len] = '\0';
+    }
+    size_t n = (size_t)len < size - 1 ? (size_t)len : size - 1;
+    memcpy(name, buf, n);
+    name[n] = '\0';
+    return true;
+}
+
+const char *proc_stat_fields(const char *buf, size_t len) {
+    const char *p = (const char*)memrchr(buf, ')', len);
+    if (p == nullptr) {
+        return nullptr;
+    }
+    p++;
+    while (*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+bool proc_stat_comm(const char *buf, size_t len, char *name, size_t size) {
+    const char *begin = (const char*)memchr(buf, '(', len);
+    const char *end = (const char*)memrchr(buf, ')', len);
+    if (begin == nullptr || end == nullptr || end < begin) {
+        return false;
+    }
+    begin++;
+    size_t n = (size_t)(end - begin) < size - 1 ? (size_t)(end - begin) : size - 1;
+    memcpy(name, begin, n);
+    name[n] = '\0';
+    return true;
+}
+
+bool proc_stat_field(const char *buf, size_t len, int field, uint64_t *value) {
+    const char *p = proc_stat_fields(buf, len);
+    if (p == nullptr) {
+        return false;
+    }
+    for (int i = 3; i < field; ++i) {
+        while (*p != ' ' && *p != '\0') {
+            p++;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+    }
+    if (*p < '0' || *p > '9') {
+        return false;
+    }
+    uint64_t v = 0;
+    for (; *p >= '0' && *p <= '9'; ++p) {
+        v = v * 10 + (*p - '0');
+    }
+    *value = v;
+    return true;
+}
+
+bool proc_for_each_id_in_file(int dir_fd, const char *path, void (*fn)(int id, void *arg), void *arg) {
+    char buf[4096];
+    int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    int id = -1;
+    ssize_t len;
+    bool ok = true;
+    for (;;) {
+        len = read(fd, buf, sizeof(buf));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            ok = len == 0;
+            break;
+        }
+        /* A number may span two reads, so keep the partial value in id. */
+        for (ssize_t i = 0; i < len; ++i) {
+            if (buf[i] >= '0' && buf[i] <= '9') {
+                id = (id < 0 ? 0 : id * 10) + (buf[i] - '0');
+            } else if (id >= 0) {
+                fn(id, arg);
+                id = -1;
+            }
+        }
+    }
+    if (id >= 0) {
+        fn(id, arg);
+    }
+    close(fd);
+    return ok;
+}
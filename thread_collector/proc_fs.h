@@ -0,0 +1,97 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef PROC_FS_H
+#define PROC_FS_H
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+const int PROC_PATH_MAX = 64;
+const int DENTS_BUF_SIZE = 16384;
+/* Enough for a comm file, which is at most 64 bytes for kernel workers. */
+const int PROC_COMM_BUF_SIZE = 64;
+
+/* Builds a path relative to a directory fd on the stack, e.g. "<pid>/task/<tid>/comm". */
+class ProcPath {
+public:
+    ProcPath() : len(0) { buf[0] = '\0'; }
+    ProcPath &add(int id);
+    ProcPath &add(const char *s);
+    const char *c_str() const { return buf; }
+private:
+    char buf[PROC_PATH_MAX];
+    int len;
+};
+
+/* Parses a directory entry name made of digits only, returns -1 otherwise. */
+int proc_parse_id(const char *name);
+/* Opens a directory relative to dir_fd, e.g. "<pid>/task" relative to the /proc fd. */
+int proc_open_dir(int dir_fd, const char *path);
+/* Reads the whole small file into buf and NUL-terminates it. Returns the length or -1. */
+ssize_t proc_read_at(int dir_fd, const char *path, char *buf, size_t size);
+/* Reads a comm file into name (TASK_COMM_LEN bytes) without the trailing newline. */
+bool proc_read_comm(int dir_fd, const char *path, char *name, size_t size);
+/* Same for the content of a comm file that was already read. */
+bool proc_parse_comm(char *buf, ssize_t len, char *name, size_t size);
+
+/* Returns the first field after the comm of a stat line (the state, field 3). comm may
+ * contain ')' and is not bounded by TASK_COMM_LEN for kernel workers, so this looks for
+ * the last ')'. Returns nullptr if the line is malformed.
+ */
+const char *proc_stat_fields(const char *buf, size_t len);
+/* Copies the comm of a stat line into name, truncated to size - 1 bytes. */
+bool proc_stat_comm(const char *buf, size_t len, char *name, size_t size);
+/* Reads field (numbered as in proc(5), at least 3) of a stat line. */
+bool proc_stat_field(const char *buf, size_t len, int field, uint64_t *value);
+
+/* Calls fn(id) for every whitespace separated number in a file of any size, such as
+ * cgroup.procs. Returns false if the file could not be opened.
+ */
+bool proc_for_each_id_in_file(int dir_fd, const char *path, void (*fn)(int id, void *arg), void *arg);
+
+struct ProcDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Calls fn(id) for every numeric entry of an open directory, rewinding it first so
+ * that the same fd can be walked again in the next cycle.
+ */
+template <typename Fn>
+void proc_for_each_id(int dir_fd, Fn &&fn) {
+    alignas(ProcDirent64) char buf[DENTS_BUF_SIZE];
+
+    if (lseek(dir_fd, 0, SEEK_SET) < 0) {
+        return;
+    }
+    for (;;) {
+        long n = syscall(SYS_getdents64, dir_fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        for (long off = 0; off < n;) {
+            const ProcDirent64 *d = (const ProcDirent64*)(buf + off);
+            off += d->d_reclen;
+            int id = proc_parse_id(d->d_name);
+            if (id > 0) {
+                fn(id);
+            }
+        }
+    }
+}
+
+#endif // !PROC_FS_H
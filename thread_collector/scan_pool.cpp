@@ -0,0 +1,89 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "scan_pool.h"
+#include <system_error>
+#include <pthread.h>
+#include <signal.h>
+
+bool ScanPool::start(int n) {
+    stop();
+    {
+        /* New workers start from seen = 0, so the job of an earlier pool must not count. */
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = false;
+        job_gen = 0;
+    }
+    /* Workers must not take the signals meant for the framework. */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 1; i < n; ++i) {
+        try {
+            workers.emplace_back(&ScanPool::worker_main, this, i);
+        } catch (const std::system_error &) {
+            break;
+        }
+        pthread_setname_np(workers.back().native_handle(), "thread_scan");
+    }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    return size() == n;
+}
+
+void ScanPool::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto &t : workers) {
+        t.join();
+    }
+    workers.clear();
+}
+
+void ScanPool::run(void (*fn)(int, void*), void *fn_arg) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job = fn;
+        arg = fn_arg;
+        pending = workers.size();
+        job_gen++;
+    }
+    start_cv.notify_all();
+    fn(0, fn_arg);
+    std::unique_lock<std::mutex> guard(lock);
+    done_cv.wait(guard, [this] { return pending == 0; });
+}
+
+void ScanPool::worker_main(int worker) {
+    unsigned long seen = 0;
+    for (;;) {
+        void (*fn)(int, void*);
+        void *fn_arg;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            start_cv.wait(guard, [&] { return stopping || job_gen != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = job_gen;
+            fn = job;
+            fn_arg = arg;
+        }
+        fn(worker, fn_arg);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending--;
+        }
+        done_cv.notify_one();
+    }
+}
@@ -0,0 +1,44 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef SCAN_POOL_H
+#define SCAN_POOL_H
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A fixed set of worker threads that run the same job once per cycle. The calling
+ * thread takes part as worker 0, so a pool of size 1 starts no thread.
+ */
+class ScanPool {
+public:
+    ScanPool() : job(nullptr), arg(nullptr), job_gen(0), pending(0), stopping(false) {}
+    ~ScanPool() { stop(); }
+    bool start(int n);
+    void stop();
+    int size() const { return (int)workers.size() + 1; }
+    /* Runs job(worker, arg) on every worker and returns when all of them are done. */
+    void run(void (*fn)(int worker, void *arg), void *fn_arg);
+private:
+    void worker_main(int worker);
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    void (*job)(int, void*);
+    void *arg;
+    unsigned long job_gen;
+    int pending;
+    bool stopping;
+};
+
+#endif // !SCAN_POOL_H
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef SNAPSHOT_RING_H
+#define SNAPSHOT_RING_H
+#include "interface.h"
+#include <vector>
+
+/* Ring depth. A published snapshot stays untouched for SNAPSHOT_NUM - 1 more cycles,
+ * so consumers can read it without locks and diff consecutive snapshots.
+ */
+const int SNAPSHOT_NUM = 4;
+
+/* A DataRingBuf whose slots own immutable arrays of T. The producer fills the oldest
+ * slot and then publishes it with release stores.
+ */
+template <typename T>
+class SnapshotRing {
+public:
+    void reset(const char *name) {
+        ring.instance_name = name;
+        ring.count = 0;
+        ring.index = -1;
+        ring.buf_len = SNAPSHOT_NUM;
+        ring.buf = bufs;
+    }
+    /* The array of the slot that the next publish() makes current. */
+    std::vector<T> &next() {
+        return slots[(ring.index + 1) % SNAPSHOT_NUM];
+    }
+    void publish() {
+        publish(next().size());
+    }
+    /* Publishes the first len elements as the array, the rest of the slot is trailing
+     * data that consumers locate after it.
+     */
+    void publish(int len) {
+        int index = (ring.index + 1) % SNAPSHOT_NUM;
+        bufs[index].len = len;
+        bufs[index].data = (void*)slots[index].data();
+        __atomic_store_n(&ring.count, ring.count + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&ring.index, index, __ATOMIC_RELEASE);
+    }
+    const DataRingBuf *get() const {
+        return &ring;
+    }
+private:
+    DataRingBuf ring;
+    DataBuf bufs[SNAPSHOT_NUM];
+    std::vector<T> slots[SNAPSHOT_NUM];
+};
+
+#endif // !SNAPSHOT_RING_H
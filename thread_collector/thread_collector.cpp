@@ -11,122 +11,410 @@
  ******************************************************************************/
 #include "interface.h"
 #include "thread_info.h"
-#include <iostream>
-#include <string>
+#include "thread_table.h"
+#include "proc_connector.h"
+#include "proc_fs.h"
+#include "snapshot_ring.h"
+#include "thread_collector.h"
+#include "collector_config.h"
+#include "scan_pool.h"
+#include "thread_scope.h"
+#include "proc_batch.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include <vector>
-#include <fstream>
-#include <unordered_map>
-#include <csignal>
-#include <dirent.h>
-#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 char thread_name[] = "thread_collector";
+char delta_name[] = "thread_collector_delta";
 const int CYCLE_SIZE = 500;
-static DataRingBuf ring_buf;
-static DataBuf data_buf;
-static ThreadInfo threads[THREAD_NUM];
-/* For quickly access to the threads array. key: tid, value: the index of threads[THREAD_NUM]. */
-static std::unordered_map<int, int> tids;
-/* Saves the last modification time of the task dir in process. */
-static std::unordered_map<int, long int> task_time;
-
-static void clear_invalid_tid(int &num) {
-    int cur = -1;
-
-    for (int i = 0; i < num; ++i) {
-        auto tid = threads[i].tid;
-        std::string task_path = "/proc/" + std::to_string(threads[i].pid) + "/task/" + std::to_string(threads[i].tid);
-        /* If current thread does not exist, clear it. */
-        if (access(task_path.c_str(), F_OK) < 0) {
-            tids.erase(tid);
-            if (task_time.count(tid)) {
-                task_time.erase(tid);
+/* Immutable copies of the thread table. */
+static SnapshotRing<ThreadInfo> ring_buf;
+/* The working table, only touched by run(). */
+static ThreadTable threads;
+struct ProcState {
+    int pid;
+    /* num_threads from stat and the number of threads collected when the threads of the
+     * process were last collected.
+     */
+    int num_threads;
+    int tid_count;
+    /* start_time and comm of the process from stat, a change means the pid was reused
+     * or the process exec'd.
+     */
+    uint64_t start_time;
+    char comm[THREAD_NAME_LEN];
+    /* The generation in which the process was seen in /proc. */
+    uint32_t seen_gen;
+    /* The generation in which the process was skipped as unchanged. */
+    uint32_t skip_gen;
+};
+static std::vector<ProcState> procs;
+/* key: pid, value: the index of procs. */
+static IdIndex proc_index;
+/* Incremented by every /proc walk. */
+static uint32_t cur_gen = 0;
+/* Kept open across cycles, all /proc accesses are relative to it. */
+static int proc_fd = -1;
+/* Proc connector socket, -1 if threads are tracked by scanning /proc every cycle. */
+static int conn_fd = -1;
+/* Set at startup and after the connector overran, the next run does a full scan. */
+static bool need_full_scan = true;
+static std::vector<ProcEvent> proc_events;
+/* Delta instance: the thread events since its last run, recorded only while it is enabled. */
+static bool delta_enabled = false;
+static uint64_t event_seq = 0;
+static std::vector<ThreadEvent> pending_events;
+static SnapshotRing<ThreadEvent> delta_ring_buf;
+
+static void record_event(ThreadEventType type, const ThreadInfo &info) {
+    if (!delta_enabled) {
+        return;
+    }
+    ThreadEvent ev;
+    ev.seq = ++event_seq;
+    ev.type = type;
+    ev.info = info;
+    pending_events.push_back(ev);
+}
+
+/* Reads the thread name relative to dir_fd, which is either /proc or the task dir of the process. */
+static bool get_thread_info(int dir_fd, const char *comm_path, int pid, int tid, ThreadInfo *info) {
+    if (!proc_read_comm(dir_fd, comm_path, info->name, sizeof(info->name))) {
+        return false;
+    }
+    info->pid = pid;
+    info->tid = tid;
+    return true;
+}
+
+static bool read_thread_info(int pid, int tid, ThreadInfo *info) {
+    ProcPath comm_path;
+    comm_path.add(pid).add("/task/").add(tid).add("/comm");
+    return get_thread_info(proc_fd, comm_path.c_str(), pid, tid, info);
+}
+
+/* Events of an earlier cycle may name a thread that has exited since. */
+static bool thread_exists(int pid, int tid) {
+    ProcPath task_path;
+    task_path.add(pid).add("/task/").add(tid);
+    return faccessat(proc_fd, task_path.c_str(), F_OK, 0) == 0;
+}
+
+static void add_thread(const ThreadInfo &info) {
+    int slot = threads.find(info.tid);
+    if (slot < 0) {
+        threads.add(info, cur_gen);
+        record_event(THREAD_ADDED, info);
+        return;
+    }
+    if (threads.pid[slot] != info.pid || strncmp(threads.name[slot].s, info.name, THREAD_NAME_LEN) != 0) {
+        threads.set(slot, info);
+        record_event(THREAD_RENAMED, info);
+    }
+    threads.gen[slot] = cur_gen;
+}
+
+static void remove_thread(int tid) {
+    int slot = threads.find(tid);
+    if (slot < 0) {
+        return;
+    }
+    record_event(THREAD_EXITED, threads.get(slot));
+    threads.remove(slot);
+}
+
+static void remove_process_threads(int pid, int keep_tid) {
+    for (int i = threads.size() - 1; i >= 0; --i) {
+        if (threads.pid[i] == pid && threads.tid[i] != keep_tid) {
+            remove_thread(threads.tid[i]);
+        }
+    }
+}
+
+static void handle_proc_event(const ProcEvent &ev) {
+    ThreadInfo info;
+    switch (ev.type) {
+        case PROC_CONN_FORK: {
+            /* A new process inherits the comm of the thread that forked it. For a new thread,
+             * the event reports the parent of the process instead of the creating thread.
+             */
+            int parent = ev.pid == ev.tgid ? threads.find(ev.parent_pid) : -1;
+            /* A new process may reuse the pid of one that exited within the cycle. */
+            if (ev.pid == ev.tgid) {
+                proc_attr_invalidate(ev.pid);
             }
-            /* Find the first invalid position. */
-            if (cur == -1) {
-                cur = i;
+            if (parent >= 0 && thread_exists(ev.tgid, ev.pid)) {
+                info = threads.get(parent);
+                info.pid = ev.tgid;
+                info.tid = ev.pid;
+                add_thread(info);
+            } else if (read_thread_info(ev.tgid, ev.pid, &info)) {
+                add_thread(info);
             }
-            continue;
+            break;
         }
-        /* Update threads by moving threads in the back to the front */
-        if (cur != -1) {
-            threads[cur++] = threads[i];
+        case PROC_CONN_EXEC:
+            /* If a non-leader thread execs, the leader exits first and the thread takes over
+             * the tgid, so its old tid never gets an exit event.
+             */
+            if (threads.find(ev.tgid) < 0) {
+                remove_process_threads(ev.tgid, ev.tgid);
+            }
+            proc_attr_invalidate(ev.tgid);
+            if (read_thread_info(ev.tgid, ev.tgid, &info)) {
+                add_thread(info);
+            }
+            break;
+        case PROC_CONN_COMM: {
+            int slot = threads.find(ev.pid);
+            if (slot >= 0) {
+                info = threads.get(slot);
+                memcpy(info.name, ev.comm, THREAD_NAME_LEN);
+                add_thread(info);
+            }
+            break;
         }
+        case PROC_CONN_EXIT:
+            remove_thread(ev.pid);
+            break;
     }
-    /* Update thread total number. */
-    if (cur != -1) {
-        num = cur;
+}
+
+/* Applies the events received since the last cycle. Returns false if events were lost. */
+static bool update_threads_by_events() {
+    proc_events.clear();
+    int ret = proc_connector_recv(conn_fd, proc_events);
+    for (auto &ev : proc_events) {
+        handle_proc_event(ev);
     }
+    return ret == 0;
 }
 
-static ThreadInfo get_thread_info(int pid, int tid) {
-    std::string s_path = "/proc/" + std::to_string(pid) + "/task/" + std::to_string(tid) + "/comm";
-    std::ifstream input_file(s_path); 
-    if (!input_file) {
-        return ThreadInfo{};
+static ProcState &get_proc_state(int pid) {
+    int slot = proc_index.find(pid);
+    if (slot < 0) {
+        slot = procs.size();
+        procs.push_back(ProcState{pid, 0, 0, 0, {0}, 0, 0});
+        proc_index.set(pid, slot);
     }
-    std::string name;
-    input_file >> name;
-    return ThreadInfo{pid, tid, name};
+    return procs[slot];
 }
 
-static bool process_not_change(struct stat *task_stat, const std::string &task_path, int pid) {
-    return stat(task_path.c_str(), task_stat) != 0 || (task_time.count(pid) && task_time[pid] == task_stat->st_mtime);
+/* What one worker found for a process during the walk. */
+struct PidScan {
+    int pid;
+    bool changed;
+    int num_threads;
+    uint64_t start_time;
+    char comm[THREAD_NAME_LEN];
+    /* Range of the threads of the process in ScanShard::threads. */
+    int first;
+    int count;
+};
+
+/* Local result of one worker, merged into the table after the walk. */
+struct ScanShard {
+    std::vector<PidScan> pids;
+    std::vector<ThreadInfo> threads;
+    /* The tids and the batched comm reads of the process being walked. */
+    std::unique_ptr<ProcBatchReader> reader;
+    std::vector<int> tids;
+    std::vector<ProcReadReq> reqs;
+    std::vector<char> comm_bufs;
+};
+
+/* Below this many processes a parallel walk costs more than it saves. */
+const int PARALLEL_MIN_PIDS = 256;
+/* Processes taken by a worker at a time. */
+const int SCAN_CHUNK = 32;
+static ScanPool scan_pool;
+static ThreadScope scope;
+static std::vector<ScanShard> shards(1);
+static std::vector<int> scan_pids;
+static std::atomic<int> scan_next(0);
+
+/* The tid set of shard.tids against the threads collected for the process. A thread that
+ * exited while another started keeps num_threads and the task dir mtime, but not the set.
+ */
+static bool tids_not_change(int pid, const ProcState &state, const ScanShard &shard) {
+    if ((int)shard.tids.size() != state.tid_count) {
+        return false;
+    }
+    for (int tid : shard.tids) {
+        int slot = threads.find(tid);
+        if (slot < 0 || threads.pid[slot] != pid) {
+            return false;
+        }
+    }
+    return true;
 }
 
-static void collect_threads(int pid, DIR *task_dir, int &num) {
-    struct dirent *task_entry;
-    while ((task_entry = readdir(task_dir)) != nullptr) {
-        if (!isdigit(task_entry->d_name[0])) {
-            continue;
+static bool process_not_change(int task_fd, PidScan *scan, ScanShard &shard) {
+    char buf[1024];
+    ProcPath stat_path;
+    stat_path.add(scan->pid).add("/stat");
+    /* Sample stat and the tids before the comms are read, so that a change made during
+     * the walk is seen by the next cycle.
+     */
+    ssize_t len = proc_read_at(proc_fd, stat_path.c_str(), buf, sizeof(buf));
+    uint64_t num_threads = 0;
+    bool stat_ok = len > 0 && proc_stat_field(buf, len, 20, &num_threads) &&
+        proc_stat_field(buf, len, 22, &scan->start_time) && proc_stat_comm(buf, len, scan->comm, THREAD_NAME_LEN);
+    shard.tids.clear();
+    proc_for_each_id(task_fd, [&](int tid) {
+        shard.tids.push_back(tid);
+    });
+    if (!stat_ok) {
+        return false;
+    }
+    scan->num_threads = (int)num_threads;
+    int slot = proc_index.find(scan->pid);
+    /* An exec keeps the thread count and the task dir, but renames the process. */
+    return slot >= 0 && procs[slot].num_threads == scan->num_threads && procs[slot].start_time == scan->start_time &&
+        strncmp(procs[slot].comm, scan->comm, THREAD_NAME_LEN) == 0 && tids_not_change(scan->pid, procs[slot], shard);
+}
+
+/* Reads the comms of the tids found by process_not_change. */
+static void collect_threads(int pid, int task_fd, ScanShard &shard) {
+    int n = shard.tids.size();
+    shard.reqs.resize(n);
+    shard.comm_bufs.resize(n * PROC_COMM_BUF_SIZE);
+    for (int i = 0; i < n; ++i) {
+        ProcReadReq &req = shard.reqs[i];
+        req.path = ProcPath();
+        req.path.add(shard.tids[i]).add("/comm");
+        req.buf = &shard.comm_bufs[i * PROC_COMM_BUF_SIZE];
+        req.size = PROC_COMM_BUF_SIZE;
+    }
+    shard.reader->read(task_fd, shard.reqs.data(), n);
+    for (int i = 0; i < n; ++i) {
+        ThreadInfo info;
+        if (proc_parse_comm(shard.reqs[i].buf, shard.reqs[i].len, info.name, sizeof(info.name))) {
+            info.pid = pid;
+            info.tid = shard.tids[i];
+            shard.threads.push_back(info);
         }
-        int tid = atoi(task_entry->d_name);
-        /* Update if the thread exists. */
-        if (tids.count(tid)) {
-            threads[tids[tid]] = get_thread_info(pid, tid);
+    }
+}
+
+/* Only reads the table, so workers may call it concurrently. */
+static void scan_process(int pid, ScanShard &shard) {
+    ProcPath task_path;
+    task_path.add(pid).add("/task");
+    int task_fd = proc_open_dir(proc_fd, task_path.c_str());
+    if (task_fd < 0) {
+        return;
+    }
+    PidScan scan = {pid, false, -1, 0, {0}, (int)shard.threads.size(), 0};
+    /* Continue if the process does not change */
+    if (!process_not_change(task_fd, &scan, shard)) {
+        scan.changed = true;
+        collect_threads(pid, task_fd, shard);
+        scan.count = shard.threads.size() - scan.first;
+    }
+    close(task_fd);
+    shard.pids.push_back(scan);
+}
+
+static void merge_shard(const ScanShard &shard) {
+    for (auto &scan : shard.pids) {
+        ProcState &state = get_proc_state(scan.pid);
+        state.seen_gen = cur_gen;
+        if (!scan.changed) {
+            state.skip_gen = cur_gen;
             continue;
         }
-        /* If the thread does not exist, add it. */
-        if (num < THREAD_NUM) {
-            tids[tid] = num;
-            threads[num++] = get_thread_info(pid, tid);
+        if (scan.start_time != 0 && state.start_time != 0 && (state.start_time != scan.start_time ||
+            strncmp(state.comm, scan.comm, THREAD_NAME_LEN) != 0)) {
+            proc_attr_invalidate(scan.pid);
+        }
+        /* Update the change stamps of the process. */
+        state.num_threads = scan.num_threads;
+        state.tid_count = scan.count;
+        state.start_time = scan.start_time;
+        memcpy(state.comm, scan.comm, THREAD_NAME_LEN);
+        /* Update threads info */
+        for (int i = scan.first; i < scan.first + scan.count; ++i) {
+            add_thread(shard.threads[i]);
         }
     }
 }
 
-static int get_all_threads(int &num) {
-    DIR *proc_dir = opendir("/proc");
-    if (proc_dir == nullptr) {
-        return 0;
+static void scan_worker(int worker, void *arg) {
+    (void)arg;
+    ScanShard &shard = shards[worker];
+    int total = scan_pids.size();
+    for (;;) {
+        int begin = scan_next.fetch_add(SCAN_CHUNK, std::memory_order_relaxed);
+        if (begin >= total) {
+            break;
+        }
+        int end = begin + SCAN_CHUNK < total ? begin + SCAN_CHUNK : total;
+        for (int i = begin; i < end; ++i) {
+            scan_process(scan_pids[i], shard);
+        }
     }
-    clear_invalid_tid(num);
-    struct dirent *entry;
-    while ((entry = readdir(proc_dir)) != nullptr) {
-        if (!isdigit(entry->d_name[0])) {
-            continue;
+}
+
+/* Removes the threads that were not seen by the walk of the current generation,
+ * keeping the threads of processes skipped as unchanged.
+ */
+static void sweep_threads() {
+    threads.remove_if([](int i) {
+        if (threads.gen[i] == cur_gen) {
+            return false;
         }
-        int pid = atoi(entry->d_name);
-        std::string task_path = "/proc/" + std::to_string(pid) + "/task";
-        DIR *task_dir = opendir(task_path.c_str());
-        if (task_dir == nullptr) {
-            continue;
+        int slot = proc_index.find(threads.pid[i]);
+        if (slot >= 0 && procs[slot].skip_gen == cur_gen) {
+            return false;
         }
-        struct stat task_stat;
-        /* Continue if the process does not change */
-        if (process_not_change(&task_stat, task_path, pid)) {
-            closedir(task_dir);
+        record_event(THREAD_EXITED, threads.get(i));
+        return true;
+    });
+    for (int i = (int)procs.size() - 1; i >= 0; --i) {
+        if (procs[i].seen_gen == cur_gen) {
             continue;
         }
-        /* Update last modification time of the process. */
-        task_time[pid] = task_stat.st_mtime;
-        /* Update threads info */
-        collect_threads(pid, task_dir, num); 
-        closedir(task_dir);
-        
+        proc_index.erase(procs[i].pid);
+        if (i != (int)procs.size() - 1) {
+            procs[i] = procs.back();
+            proc_index.set(procs[i].pid, i);
+        }
+        procs.pop_back();
+    }
+}
+
+static void get_all_threads() {
+    if (proc_fd < 0) {
+        return;
+    }
+    cur_gen++;
+    for (auto &shard : shards) {
+        shard.pids.clear();
+        shard.threads.clear();
+    }
+    if (scope.enabled()) {
+        scope.list_pids(proc_fd, scan_pids);
+    } else {
+        scan_pids.clear();
+        proc_for_each_id(proc_fd, [](int pid) {
+            scan_pids.push_back(pid);
+        });
     }
-    closedir(proc_dir);
-    return num;
+    scan_next.store(0, std::memory_order_relaxed);
+    /* Shard the pids across the pool, each worker fills its own result. */
+    if (scan_pool.size() > 1 && scan_pids.size() >= (size_t)PARALLEL_MIN_PIDS) {
+        scan_pool.run(scan_worker, nullptr);
+    } else {
+        scan_worker(0, nullptr);
+    }
+    for (auto &shard : shards) {
+        merge_shard(shard);
+    }
+    sweep_threads();
 }
 
 const char* get_name() {
@@ -148,33 +436,140 @@ int get_priority() {
     return 0;
 }
 bool enable() {
-    tids.clear();
-    task_time.clear();
-    ring_buf.count = 0;
-    ring_buf.index = -1;
-    ring_buf.buf_len = 1;
-    ring_buf.buf = &data_buf; 
+    threads.clear();
+    procs.clear();
+    proc_index.clear();
+    load_collector_config();
+    const CollectorConfig &config = get_collector_config();
+    if (!scope.load(config)) {
+        return false;
+    }
+    if (proc_fd >= 0) {
+        close(proc_fd);
+    }
+    proc_fd = proc_open_dir(AT_FDCWD, config.proc_root.c_str());
+    if (proc_fd < 0) {
+        return false;
+    }
+    int workers = config.scan_workers;
+    if (scan_pool.size() != workers) {
+        scan_pool.start(workers);
+        shards.resize(scan_pool.size());
+    }
+    for (auto &shard : shards) {
+        if (!shard.reader) {
+            shard.reader.reset(new ProcBatchReader());
+        }
+        if (config.io_uring) {
+            (void)shard.reader->init(config.io_timeout_ms, PROC_COMM_BUF_SIZE);
+        } else {
+            shard.reader->exit();
+        }
+    }
+    /* Fall back to scanning /proc every cycle if the proc connector is unavailable.
+     * A scoped walk is cheap and follows cgroup moves and renames exactly, so it
+     * does not use the connector.
+     */
+    conn_fd = scope.enabled() || config.proc_root != "/proc" ? -1 : proc_connector_open();
+    need_full_scan = true;
+    ring_buf.reset(thread_name);
     return true;
 }
 
 void disable() {
-    
+    proc_connector_close(conn_fd);
+    conn_fd = -1;
+    scan_pool.stop();
+    shards.resize(1);
+    shards[0].reader.reset();
+    if (proc_fd >= 0) {
+        close(proc_fd);
+        proc_fd = -1;
+    }
 }
 
 const DataRingBuf* get_ring_buf() {
-    return &ring_buf;
+    return ring_buf.get();
+}
+
+/* Copies the working table into the oldest slot and then makes it the current one. */
+static void publish_snapshot() {
+    std::vector<ThreadInfo> &snapshot = ring_buf.next();
+    int n = threads.size();
+    /* The tid index follows the array in the same slot, rounded up to whole elements. */
+    size_t index_num = (thread_index_size(n) + sizeof(ThreadInfo) - 1) / sizeof(ThreadInfo);
+    snapshot.resize(n + index_num);
+    threads.copy_to(snapshot.data());
+    thread_index_build(snapshot.data(), n, (ThreadIndex*)(snapshot.data() + n));
+    ring_buf.publish(n);
+}
+
+const ThreadTable &get_thread_table() {
+    return threads;
+}
+
+int get_proc_fd() {
+    return proc_fd;
 }
 
 void run(const Param *param) {
     (void)param;
-    ring_buf.count++;
-    int index = (ring_buf.index + 1) % ring_buf.buf_len;
-    int num = data_buf.len;
-    get_all_threads(num);
-    data_buf.len = num;
-    data_buf.data = (void*)threads;
-    ring_buf.buf[index] = data_buf;
-    ring_buf.index = index;
+    if (conn_fd >= 0 && !need_full_scan && !update_threads_by_events()) {
+        need_full_scan = true;
+    }
+    if (conn_fd < 0 || need_full_scan) {
+        /* Events may have been missed, so do not trust the unchanged processes. The events
+         * still queued predate the scan and would replay exited threads on top of it.
+         */
+        if (conn_fd >= 0) {
+            proc_connector_drain(conn_fd);
+            procs.clear();
+            proc_index.clear();
+        }
+        get_all_threads();
+        need_full_scan = false;
+    }
+    publish_snapshot();
+}
+
+const char* delta_get_name() {
+    return delta_name;
+}
+
+const char* delta_get_description() {
+    return "threads added, exited or renamed since the previous cycle";
+}
+
+const char* delta_get_dep() {
+    return thread_name;
+}
+
+bool delta_enable() {
+    pending_events.clear();
+    delta_ring_buf.reset(delta_name);
+    delta_enabled = true;
+    /* Start consumers from the current table, as if every thread was just added. */
+    for (int i = 0; i < threads.size(); ++i) {
+        record_event(THREAD_ADDED, threads.get(i));
+    }
+    return true;
+}
+
+void delta_disable() {
+    delta_enabled = false;
+    pending_events.clear();
+}
+
+const DataRingBuf* delta_get_ring_buf() {
+    return delta_ring_buf.get();
+}
+
+/* Publishes the events recorded by thread_collector since the last run. */
+void delta_run(const Param *param) {
+    (void)param;
+    delta_ring_buf.next().swap(pending_events);
+    pending_events.clear();
+    delta_ring_buf.publish();
 }
 
 struct Interface thread_collect = {
@@ -191,7 +586,28 @@ struct Interface thread_collect = {
     .run = run,
 };
 
+struct Interface thread_delta_collect = {
+    .get_version = get_version,
+    .get_name = delta_get_name,
+    .get_description = delta_get_description,
+    .get_dep = delta_get_dep,
+    .get_priority = get_priority,
+    .get_type = nullptr,
+    .get_period = get_period,
+    .enable = delta_enable,
+    .disable = delta_disable,
+    .get_ring_buf = delta_get_ring_buf,
+    .run = delta_run,
+};
+
+static Interface instances[4];
+
 extern "C" int get_instance(Interface **ins) {
-    *ins = &thread_collect;
-    return 1;
+    int count = 0;
+    instances[count++] = thread_collect;
+    instances[count++] = thread_delta_collect;
+    instances[count++] = thread_sched_collect;
+    instances[count++] = thread_proc_collect;
+    *ins = instances;
+    return count;
 }
@@ -9,27 +9,22 @@
  * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
  * See the Mulan PSL v2 for more details.
  ******************************************************************************/
-#ifndef __PMU_NAPI_GRO_RECEIVE_ENTRY_H__
-#define __PMU_NAPI_GRO_RECEIVE_ENTRY_H__
+#ifndef THREAD_COLLECTOR_H
+#define THREAD_COLLECTOR_H
+#include "interface.h"
+#include "thread_table.h"
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+/* State of thread_collector shared with the instances that depend on it. */
+const ThreadTable &get_thread_table();
+/* The kept /proc directory fd, -1 while thread_collector is disabled. */
+int get_proc_fd();
+/* The version every instance of the plugin reports. */
+const char* get_version();
 
-const char *NapiGroRecEntryGetVer();
-const char *NapiGroRecEntryGetName();
-const char *NapiGroRecEntryGetDes();
-const char *NapiGroRecEntryGetDep();
-int NapiGroRecEntryGetPriority();
-int NapiGroRecEntryGetType();
-int NapiGroRecEntryGetPeriod();
-bool NapiGroRecEntryEnable();
-void NapiGroRecEntryDisable();
-const struct DataRingBuf *NapiGroRecEntryGetBuf();
-void NapiGroRecEntryRun(const struct Param *param);
+/* Drops the cached attributes of a process after it exec'd or its pid was reused. */
+void proc_attr_invalidate(int pid);
 
-#ifdef __cplusplus
-}
-#endif
+extern struct Interface thread_sched_collect;
+extern struct Interface thread_proc_collect;
 
-#endif
+#endif // !THREAD_COLLECTOR_H
@@ -0,0 +1,298 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "interface.h"
+#include "thread_info.h"
+#include "thread_collector.h"
+#include "proc_fs.h"
+#include "snapshot_ring.h"
+#include "collector_config.h"
+#include "proc_batch.h"
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <unistd.h>
+
+char sched_name[] = "thread_sched_collector";
+const int SCHED_CYCLE_SIZE = 1000;
+const int STAT_BUF_SIZE = 512;
+const int SCHEDSTAT_BUF_SIZE = 128;
+const int STATUS_BUF_SIZE = 8192;
+/* Threads whose stat, schedstat and status are read in one batch. */
+const int SCHED_BATCH = 32;
+enum SchedFile {
+    SCHED_FILE_STAT,
+    SCHED_FILE_SCHEDSTAT,
+    SCHED_FILE_STATUS,
+    SCHED_FILE_NUM,
+};
+
+/* Cumulative counters of a thread, the published values are deltas of them. */
+struct SchedCounters {
+    int tid;
+    int cpu;
+    /* In clock ticks since boot, tells a reused tid apart. */
+    uint64_t start_time;
+    uint64_t utime;
+    uint64_t stime;
+    uint64_t run_ns;
+    uint64_t wait_ns;
+    uint64_t nvcsw;
+    uint64_t nivcsw;
+};
+
+static SnapshotRing<ThreadSchedInfo> sched_ring_buf;
+/* Counters of the previous and the current run, swapped after every run. */
+static std::vector<SchedCounters> prev_counters;
+static std::vector<SchedCounters> cur_counters;
+static IdIndex prev_index;
+static IdIndex cur_index;
+static uint64_t last_run_ticks = 0;
+static ProcBatchReader sched_reader;
+static ProcReadReq sched_reqs[SCHED_BATCH * SCHED_FILE_NUM];
+static char sched_bufs[SCHED_BATCH][STAT_BUF_SIZE + SCHEDSTAT_BUF_SIZE + STATUS_BUF_SIZE];
+static uint64_t tick_ns = 10000000;
+
+static const char *parse_u64(const char *p, uint64_t *v) {
+    uint64_t n = 0;
+    if (*p == '-') {
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        n = n * 10 + (*p++ - '0');
+    }
+    *v = n;
+    return p;
+}
+
+/* Parses utime(14), stime(15), starttime(22) and processor(39) in a single pass. */
+static bool parse_stat(const char *buf, ssize_t len, SchedCounters *c) {
+    const char *p = proc_stat_fields(buf, len);
+    if (p == nullptr) {
+        return false;
+    }
+    for (int field = 3; field <= 39; ++field) {
+        while (*p == ' ') {
+            p++;
+        }
+        if (*p == '\0' || *p == '\n') {
+            return false;
+        }
+        uint64_t v = 0;
+        switch (field) {
+            case 14:
+                p = parse_u64(p, &c->utime);
+                break;
+            case 15:
+                p = parse_u64(p, &c->stime);
+                break;
+            case 22:
+                p = parse_u64(p, &c->start_time);
+                break;
+            case 39:
+                parse_u64(p, &v);
+                c->cpu = (int)v;
+                return true;
+            default:
+                while (*p != ' ' && *p != '\0') {
+                    p++;
+                }
+                break;
+        }
+    }
+    return false;
+}
+
+static const char *find_value(const char *buf, ssize_t len, const char *key) {
+    const char *p = (const char*)memmem(buf, len, key, strlen(key));
+    if (p == nullptr) {
+        return nullptr;
+    }
+    p += strlen(key);
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+/* Queues the reads of the counter files of a thread into reqs[SCHED_FILE_NUM]. */
+static void prepare_reads(int pid, int tid, char *buf, ProcReadReq *reqs) {
+    static const char *const files[SCHED_FILE_NUM] = {"stat", "schedstat", "status"};
+    static const size_t sizes[SCHED_FILE_NUM] = {STAT_BUF_SIZE, SCHEDSTAT_BUF_SIZE, STATUS_BUF_SIZE};
+    for (int i = 0; i < SCHED_FILE_NUM; ++i) {
+        reqs[i].path = ProcPath();
+        reqs[i].path.add(pid).add("/task/").add(tid).add("/").add(files[i]);
+        reqs[i].buf = buf;
+        reqs[i].size = sizes[i];
+        buf += sizes[i];
+    }
+}
+
+static bool parse_counters(int tid, const ProcReadReq *reqs, SchedCounters *c) {
+    const ProcReadReq &stat = reqs[SCHED_FILE_STAT];
+    if (stat.len <= 0 || !parse_stat(stat.buf, stat.len, c)) {
+        return false;
+    }
+    c->tid = tid;
+    c->run_ns = 0;
+    c->wait_ns = 0;
+    /* schedstat is missing without CONFIG_SCHED_INFO, keep zeros then. */
+    const ProcReadReq &schedstat = reqs[SCHED_FILE_SCHEDSTAT];
+    if (schedstat.len > 0) {
+        const char *p = parse_u64(schedstat.buf, &c->run_ns);
+        parse_u64(p + 1, &c->wait_ns);
+    }
+    c->nvcsw = 0;
+    c->nivcsw = 0;
+    const ProcReadReq &status = reqs[SCHED_FILE_STATUS];
+    if (status.len > 0) {
+        const char *p = find_value(status.buf, status.len, "\nvoluntary_ctxt_switches:");
+        if (p != nullptr) {
+            parse_u64(p, &c->nvcsw);
+        }
+        p = find_value(status.buf, status.len, "\nnonvoluntary_ctxt_switches:");
+        if (p != nullptr) {
+            parse_u64(p, &c->nivcsw);
+        }
+    }
+    return true;
+}
+
+static uint64_t boot_ticks() {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec) / tick_ns;
+}
+
+static uint64_t delta(uint64_t cur, uint64_t prev) {
+    return cur > prev ? cur - prev : 0;
+}
+
+static void fill_sched_info(int pid, const SchedCounters &c, ThreadSchedInfo *info) {
+    static const SchedCounters zero = {};
+    const SchedCounters *prev = &zero;
+    int slot = prev_index.find(c.tid);
+    if (slot >= 0 && prev_counters[slot].start_time == c.start_time) {
+        prev = &prev_counters[slot];
+    } else if (c.start_time <= last_run_ticks) {
+        /* Seen for the first time but older than the last run: there is no baseline yet. */
+        prev = &c;
+    }
+    info->pid = pid;
+    info->tid = c.tid;
+    info->cpu = c.cpu;
+    info->voluntary_switches = (uint32_t)delta(c.nvcsw, prev->nvcsw);
+    info->involuntary_switches = (uint32_t)delta(c.nivcsw, prev->nivcsw);
+    info->utime_ns = delta(c.utime, prev->utime) * tick_ns;
+    info->stime_ns = delta(c.stime, prev->stime) * tick_ns;
+    info->run_ns = delta(c.run_ns, prev->run_ns);
+    info->wait_ns = delta(c.wait_ns, prev->wait_ns);
+}
+
+const char* sched_get_name() {
+    return sched_name;
+}
+
+const char* sched_get_description() {
+    return "per-thread cpu time, last cpu, context switches and run-queue wait per interval";
+}
+
+const char* sched_get_dep() {
+    return "thread_collector";
+}
+
+int sched_get_period() {
+    return SCHED_CYCLE_SIZE;
+}
+
+int sched_get_priority() {
+    return 1;
+}
+
+bool sched_enable() {
+    long hz = sysconf(_SC_CLK_TCK);
+    if (hz > 0) {
+        tick_ns = 1000000000 / hz;
+    }
+    prev_counters.clear();
+    prev_index.clear();
+    last_run_ticks = boot_ticks();
+    sched_ring_buf.reset(sched_name);
+    const CollectorConfig &config = get_collector_config();
+    if (config.io_uring) {
+        (void)sched_reader.init(config.io_timeout_ms, STATUS_BUF_SIZE);
+    } else {
+        sched_reader.exit();
+    }
+    return true;
+}
+
+void sched_disable() {
+    prev_counters.clear();
+    cur_counters.clear();
+    prev_index.clear();
+    cur_index.clear();
+    sched_reader.exit();
+}
+
+const DataRingBuf* sched_get_ring_buf() {
+    return sched_ring_buf.get();
+}
+
+void sched_run(const Param *param) {
+    (void)param;
+    const ThreadTable &threads = get_thread_table();
+    int proc_fd = get_proc_fd();
+    if (proc_fd < 0) {
+        return;
+    }
+    uint64_t now = boot_ticks();
+    std::vector<ThreadSchedInfo> &out = sched_ring_buf.next();
+    out.clear();
+    cur_counters.clear();
+    cur_index.clear();
+    for (int begin = 0; begin < threads.size(); begin += SCHED_BATCH) {
+        int n = threads.size() - begin < SCHED_BATCH ? threads.size() - begin : SCHED_BATCH;
+        for (int j = 0; j < n; ++j) {
+            prepare_reads(threads.pid[begin + j], threads.tid[begin + j], sched_bufs[j], &sched_reqs[j * SCHED_FILE_NUM]);
+        }
+        sched_reader.read(proc_fd, sched_reqs, n * SCHED_FILE_NUM);
+        for (int j = 0; j < n; ++j) {
+            SchedCounters c;
+            int i = begin + j;
+            if (!parse_counters(threads.tid[i], &sched_reqs[j * SCHED_FILE_NUM], &c)) {
+                continue;
+            }
+            out.emplace_back();
+            fill_sched_info(threads.pid[i], c, &out.back());
+            cur_index.set(c.tid, cur_counters.size());
+            cur_counters.push_back(c);
+        }
+    }
+    prev_counters.swap(cur_counters);
+    prev_index.swap(cur_index);
+    last_run_ticks = now;
+    sched_ring_buf.publish();
+}
+
+struct Interface thread_sched_collect = {
+    .get_version = get_version,
+    .get_name = sched_get_name,
+    .get_description = sched_get_description,
+    .get_dep = sched_get_dep,
+    .get_priority = sched_get_priority,
+    .get_type = nullptr,
+    .get_period = sched_get_period,
+    .enable = sched_enable,
+    .disable = sched_disable,
+    .get_ring_buf = sched_get_ring_buf,
+    .run = sched_run,
+};
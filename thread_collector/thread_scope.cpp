@@ -0,0 +1,110 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "thread_scope.h"
+#include "proc_fs.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+
+const char CGROUP_ROOT[] = "/sys/fs/cgroup/";
+
+bool ThreadScope::load(const CollectorConfig &config) {
+    reset();
+    for (auto &path : config.scope_cgroups) {
+        /* Accept both absolute paths under the cgroup mount and paths relative to it. */
+        std::string dir = path;
+        if (dir.compare(0, strlen(CGROUP_ROOT), CGROUP_ROOT) != 0) {
+            size_t start = dir.find_first_not_of('/');
+            dir = CGROUP_ROOT + (start == std::string::npos ? std::string() : dir.substr(start));
+        }
+        cgroup_procs.push_back(dir + "/cgroup.procs");
+        cgroup_threads.push_back(dir + "/cgroup.threads");
+    }
+    pids = config.scope_pids;
+    if (!config.scope_comm.empty()) {
+        if (regcomp(&comm_regex, config.scope_comm.c_str(), REG_EXTENDED | REG_NOSUB) != 0) {
+            return false;
+        }
+        has_comm = true;
+    }
+    return true;
+}
+
+void ThreadScope::reset() {
+    cgroup_procs.clear();
+    cgroup_threads.clear();
+    pids.clear();
+    if (has_comm) {
+        regfree(&comm_regex);
+        has_comm = false;
+    }
+}
+
+bool ThreadScope::match_comm(int proc_fd, int pid) const {
+    char comm[THREAD_NAME_LEN];
+    ProcPath path;
+    path.add(pid).add("/comm");
+    return proc_read_comm(proc_fd, path.c_str(), comm, sizeof(comm)) &&
+        regexec(&comm_regex, comm, 0, nullptr, 0) == 0;
+}
+
+void ThreadScope::add_pid(int pid, std::vector<int> &out) {
+    if (listed.find(pid) >= 0) {
+        return;
+    }
+    listed.set(pid, 1);
+    out.push_back(pid);
+}
+
+void ThreadScope::add_cgroup_pid(int pid, void *arg) {
+    ThreadScope *scope = (ThreadScope*)arg;
+    scope->add_pid(pid, *scope->list_out);
+}
+
+/* cgroup.threads lists tids, the process to walk is the thread group of each. */
+void ThreadScope::add_cgroup_tid(int tid, void *arg) {
+    ThreadScope *scope = (ThreadScope*)arg;
+    char buf[2048];
+    ProcPath path;
+    path.add(tid).add("/status");
+    ssize_t len = proc_read_at(scope->list_proc_fd, path.c_str(), buf, sizeof(buf));
+    if (len <= 0) {
+        return;
+    }
+    const char *tgid = strstr(buf, "\nTgid:");
+    if (tgid != nullptr) {
+        scope->add_pid(atoi(tgid + strlen("\nTgid:")), *scope->list_out);
+    }
+}
+
+void ThreadScope::list_pids(int proc_fd, std::vector<int> &out) {
+    out.clear();
+    listed.clear();
+    list_proc_fd = proc_fd;
+    list_out = &out;
+    for (int pid : pids) {
+        add_pid(pid, out);
+    }
+    for (size_t i = 0; i < cgroup_procs.size(); ++i) {
+        /* cgroup.procs is not readable in threaded cgroups, use cgroup.threads there. */
+        if (!proc_for_each_id_in_file(AT_FDCWD, cgroup_procs[i].c_str(), add_cgroup_pid, this)) {
+            proc_for_each_id_in_file(AT_FDCWD, cgroup_threads[i].c_str(), add_cgroup_tid, this);
+        }
+    }
+    if (has_comm) {
+        proc_for_each_id(proc_fd, [&](int pid) {
+            if (listed.find(pid) < 0 && match_comm(proc_fd, pid)) {
+                add_pid(pid, out);
+            }
+        });
+    }
+}
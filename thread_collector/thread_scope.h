@@ -0,0 +1,49 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef THREAD_SCOPE_H
+#define THREAD_SCOPE_H
+#include "collector_config.h"
+#include "thread_table.h"
+#include <regex.h>
+#include <string>
+#include <vector>
+
+/* Selects the processes thread_collector walks from the configured cgroups, pids
+ * and comm pattern.
+ */
+class ThreadScope {
+public:
+    ThreadScope() : has_comm(false) {}
+    ~ThreadScope() { reset(); }
+    /* Returns false if the comm pattern does not compile. */
+    bool load(const CollectorConfig &config);
+    void reset();
+    bool enabled() const { return !cgroup_procs.empty() || !pids.empty() || has_comm; }
+    /* Replaces out with the pids in scope, each listed once. */
+    void list_pids(int proc_fd, std::vector<int> &out);
+private:
+    bool match_comm(int proc_fd, int pid) const;
+    void add_pid(int pid, std::vector<int> &out);
+    static void add_cgroup_pid(int pid, void *arg);
+    static void add_cgroup_tid(int tid, void *arg);
+    std::vector<std::string> cgroup_procs;
+    std::vector<std::string> cgroup_threads;
+    std::vector<int> pids;
+    bool has_comm;
+    regex_t comm_regex;
+    /* Pids already listed in the current call. */
+    IdIndex listed;
+    int list_proc_fd;
+    std::vector<int> *list_out;
+};
+
+#endif // !THREAD_SCOPE_H
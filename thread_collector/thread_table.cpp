@@ -0,0 +1,190 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#include "thread_table.h"
+#include <algorithm>
+#include <cstring>
+
+const int INDEX_INIT_BITS = 10;
+
+IdIndex::IdIndex() : count(0) {
+    entries.assign(1u << INDEX_INIT_BITS, Entry{0, 0});
+    mask = (1u << INDEX_INIT_BITS) - 1;
+    shift = 32 - INDEX_INIT_BITS;
+}
+
+void IdIndex::grow() {
+    std::vector<Entry> old;
+    old.swap(entries);
+    entries.assign(old.size() * 2, Entry{0, 0});
+    mask = entries.size() - 1;
+    shift--;
+    for (auto &e : old) {
+        if (e.id == 0) {
+            continue;
+        }
+        uint32_t i = hash(e.id);
+        while (entries[i].id != 0) {
+            i = (i + 1) & mask;
+        }
+        entries[i] = e;
+    }
+}
+
+void IdIndex::set(int id, int slot) {
+    /* Keep the load factor below 1/2. */
+    if ((uint32_t)(count + 1) * 2 > entries.size()) {
+        grow();
+    }
+    uint32_t i = hash(id);
+    while (entries[i].id != 0) {
+        if (entries[i].id == id) {
+            entries[i].slot = slot;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    entries[i] = Entry{id, slot};
+    count++;
+}
+
+void IdIndex::erase(int id) {
+    if (count == 0) {
+        return;
+    }
+    uint32_t i = hash(id);
+    while (entries[i].id != id) {
+        if (entries[i].id == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    /* Shift back the following entries of the cluster that may not stay behind the hole. */
+    uint32_t hole = i;
+    for (uint32_t j = (i + 1) & mask; entries[j].id != 0; j = (j + 1) & mask) {
+        uint32_t home = hash(entries[j].id);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            entries[hole] = entries[j];
+            hole = j;
+        }
+    }
+    entries[hole] = Entry{0, 0};
+    count--;
+}
+
+void IdIndex::clear() {
+    if (count == 0) {
+        return;
+    }
+    std::fill(entries.begin(), entries.end(), Entry{0, 0});
+    count = 0;
+}
+
+void IdIndex::swap(IdIndex &other) {
+    entries.swap(other.entries);
+    std::swap(mask, other.mask);
+    std::swap(shift, other.shift);
+    std::swap(count, other.count);
+}
+
+int ThreadTable::add(const ThreadInfo &info, uint32_t stamp) {
+    int slot = size();
+    pid.push_back(info.pid);
+    tid.push_back(info.tid);
+    name.emplace_back();
+    memcpy(name.back().s, info.name, THREAD_NAME_LEN);
+    gen.push_back(stamp);
+    index.set(info.tid, slot);
+    return slot;
+}
+
+void ThreadTable::set(int slot, const ThreadInfo &info) {
+    pid[slot] = info.pid;
+    memcpy(name[slot].s, info.name, THREAD_NAME_LEN);
+}
+
+ThreadInfo ThreadTable::get(int slot) const {
+    ThreadInfo info;
+    info.pid = pid[slot];
+    info.tid = tid[slot];
+    memcpy(info.name, name[slot].s, THREAD_NAME_LEN);
+    return info;
+}
+
+void ThreadTable::move(int from, int to) {
+    pid[to] = pid[from];
+    tid[to] = tid[from];
+    name[to] = name[from];
+    gen[to] = gen[from];
+    index.set(tid[to], to);
+}
+
+void ThreadTable::truncate(int n) {
+    pid.resize(n);
+    tid.resize(n);
+    name.resize(n);
+    gen.resize(n);
+}
+
+void ThreadTable::remove(int slot) {
+    int last = size() - 1;
+    index.erase(tid[slot]);
+    if (slot != last) {
+        move(last, slot);
+    }
+    truncate(last);
+}
+
+void ThreadTable::clear() {
+    truncate(0);
+    index.clear();
+}
+
+void ThreadTable::copy_to(ThreadInfo *out) const {
+    int n = size();
+    for (int i = 0; i < n; ++i) {
+        out[i].pid = pid[i];
+        out[i].tid = tid[i];
+        memcpy(out[i].name, name[i].s, THREAD_NAME_LEN);
+    }
+}
+
+const uint32_t THREAD_INDEX_MIN_BITS = 4;
+
+/* At most half of the buckets are used, as in IdIndex. */
+static uint32_t thread_index_bits(int n) {
+    uint32_t bits = THREAD_INDEX_MIN_BITS;
+    while ((1u << bits) < (uint32_t)n * 2) {
+        bits++;
+    }
+    return bits;
+}
+
+size_t thread_index_size(int n) {
+    return sizeof(ThreadIndex) + sizeof(int32_t) * ((size_t)1 << thread_index_bits(n));
+}
+
+void thread_index_build(const ThreadInfo *infos, int n, ThreadIndex *index) {
+    uint32_t bits = thread_index_bits(n);
+    index->magic = THREAD_INDEX_MAGIC;
+    index->shift = 32 - bits;
+    index->mask = (1u << bits) - 1;
+    for (uint32_t i = 0; i <= index->mask; ++i) {
+        index->slot[i] = THREAD_INDEX_EMPTY;
+    }
+    for (int slot = 0; slot < n; ++slot) {
+        uint32_t i = ((uint32_t)infos[slot].tid * 0x9e3779b1u) >> index->shift;
+        while (index->slot[i] != THREAD_INDEX_EMPTY) {
+            i = (i + 1) & index->mask;
+        }
+        index->slot[i] = slot;
+    }
+}
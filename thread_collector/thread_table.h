@@ -0,0 +1,115 @@
+/******************************************************************************
+ * Copyright (c) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+ * oeAware is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ ******************************************************************************/
+#ifndef THREAD_TABLE_H
+#define THREAD_TABLE_H
+#include "thread_info.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Open addressing map from a positive id (tid or pid) to a slot. Linear probing with
+ * backward shift deletion, so lookups never walk over tombstones.
+ */
+class IdIndex {
+public:
+    IdIndex();
+    /* Returns the slot of id, or -1. */
+    int find(int id) const {
+        if (count == 0) {
+            return -1;
+        }
+        for (uint32_t i = hash(id);; i = (i + 1) & mask) {
+            if (entries[i].id == id) {
+                return entries[i].slot;
+            }
+            if (entries[i].id == 0) {
+                return -1;
+            }
+        }
+    }
+    void set(int id, int slot);
+    void erase(int id);
+    void clear();
+    void swap(IdIndex &other);
+    int size() const { return count; }
+private:
+    struct Entry {
+        int id;
+        int slot;
+    };
+    uint32_t hash(int id) const { return ((uint32_t)id * 0x9e3779b1u) >> shift; }
+    void grow();
+    std::vector<Entry> entries;
+    uint32_t mask;
+    int shift;
+    int count;
+};
+
+struct ThreadName {
+    char s[THREAD_NAME_LEN];
+};
+
+/* Struct-of-arrays thread table. Columns grow with the real thread count and slots
+ * are kept dense, a removed slot is filled with the last one.
+ */
+class ThreadTable {
+public:
+    int size() const { return (int)tid.size(); }
+    int find(int id) const { return index.find(id); }
+    /* Appends a thread which must not be in the table yet, returns its slot. */
+    int add(const ThreadInfo &info, uint32_t stamp);
+    void set(int slot, const ThreadInfo &info);
+    ThreadInfo get(int slot) const;
+    /* Removes the slot by moving the last thread into it. */
+    void remove(int slot);
+    /* Removes all slots for which dead(slot) is true in one pass, keeping the order. */
+    template <typename Pred>
+    void remove_if(Pred dead);
+    void clear();
+    /* Writes the table as the ThreadInfo array consumers see. */
+    void copy_to(ThreadInfo *out) const;
+
+    std::vector<int> pid;
+    std::vector<int> tid;
+    std::vector<ThreadName> name;
+    /* Generation stamp, set when a /proc walk sees the thread. */
+    std::vector<uint32_t> gen;
+private:
+    void move(int from, int to);
+    void truncate(int n);
+    IdIndex index;
+};
+
+template <typename Pred>
+void ThreadTable::remove_if(Pred dead) {
+    int n = size();
+    int cur = 0;
+
+    for (int i = 0; i < n; ++i) {
+        if (dead(i)) {
+            index.erase(tid[i]);
+            continue;
+        }
+        if (cur != i) {
+            move(i, cur);
+        }
+        cur++;
+    }
+    truncate(cur);
+}
+
+/* Bytes of the ThreadIndex published after a snapshot of n threads. */
+size_t thread_index_size(int n);
+/* Fills index for the n threads of infos, index must have thread_index_size(n) bytes. */
+void thread_index_build(const ThreadInfo *infos, int n, ThreadIndex *index);
+
+#endif // !THREAD_TABLE_H